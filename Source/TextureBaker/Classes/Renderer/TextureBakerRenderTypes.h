@@ -4,6 +4,20 @@
 #include "Engine/TextureRenderTarget2D.h"
 #include "TextureBakerRenderTypes.generated.h"
 
+class FTextureBakerPendingReadback;
+class FTextureBakerReadbackArena;
+class FTextureBakerCompressionQueue;
+
+// How source mips are produced when baked image data is written to a texture
+struct FTextureBakerSourceMipSettings
+{
+	FTextureBakerSourceMipSettings() : bGenerateMips(false), bPreserveAlphaCoverage(false), AlphaCoverageThreshold(0.5f) {}
+
+	bool bGenerateMips;
+	bool bPreserveAlphaCoverage;
+	float AlphaCoverageThreshold;
+};
+
 UENUM(BlueprintType)
 enum class ETBImageNormalization : uint8
 {
@@ -12,6 +26,22 @@ enum class ETBImageNormalization : uint8
 	Auto		// ERangeCompressionMode::MinMaxNorm
 };
 
+UENUM(BlueprintType)
+enum class ETBOutputDestination : uint8
+{
+	Asset,		// UTexture2D asset saved to the output path
+	ImageFile	// Image file at the disk location of the output path, no asset is created
+};
+
+UENUM(BlueprintType)
+enum class ETBImageFileFormat : uint8
+{
+	PNG,	// G8, G16, BGRA8, RGBA8, RGBA16
+	EXR,	// RGBA16F
+	TGA,	// G8, BGRA8, RGBA8
+	DDS		// Uncompressed G8, G16, BGRA8, RGBA8, RGBA16, RGBA16F
+};
+
 USTRUCT(BlueprintType)
 struct TEXTUREBAKER_API FTextureBakerOutputInfo
 {
@@ -22,21 +52,27 @@ public:
 	FTextureBakerOutputInfo() : 
 		OutputDimensions(1, 1), Padding(ETexturePowerOfTwoSetting::None), 
 		DefaultColor(FColor::Black), MipGenSettings(TextureMipGenSettings::TMGS_FromTextureGroup),
+		bGenerateSourceMips(false), bPreserveAlphaCoverage(false), AlphaCoverageThreshold(0.5f),
 		OutputImageFormat(ETextureSourceFormat::TSF_BGRA8), Normalization(ETBImageNormalization::Saturate),
-		Filter(TextureFilter::TF_Default), AddressX(TextureAddress::TA_Wrap), AddressY(TextureAddress::TA_Wrap), bUseSRGB(true),
+		Filter(TextureFilter::TF_Default), AddressX(TextureAddress::TA_Wrap), AddressY(TextureAddress::TA_Wrap), bUseSRGB(true), bCompressSourceArt(false),
 		CompressionSettings(TextureCompressionSettings::TC_Default), bCompressWithoutAlpha(false),
 		LossyCompressionAmount(ETextureLossyCompressionAmount::TLCA_Default), MaxTextureSize(0),
-		CompressionQuality(ETextureCompressionQuality::TCQ_Default), LODBias(0)
+		CompressionQuality(ETextureCompressionQuality::TCQ_Default), LODBias(0),
+		TileSize(0), TileOrigin(0, 0), TileDimensions(0, 0), TileUVOffset(0.0f, 0.0f), TileUVScale(1.0f, 1.0f),
+		Destination(ETBOutputDestination::Asset), ExportFileFormat(ETBImageFileFormat::PNG)
 	{}
 
 	FTextureBakerOutputInfo(UTexture2D* CompatibleTexture, const FIntPoint& Size, ETBImageNormalization UsedNormalization = ETBImageNormalization::Saturate) :
 		OutputDimensions(Size), Padding(CompatibleTexture->PowerOfTwoMode),
 		DefaultColor(CompatibleTexture->PaddingColor), MipGenSettings(CompatibleTexture->MipGenSettings),
+		bGenerateSourceMips(false), bPreserveAlphaCoverage(false), AlphaCoverageThreshold(0.5f),
 		OutputImageFormat(CompatibleTexture->Source.GetFormat()), Normalization(UsedNormalization), 
-		Filter(CompatibleTexture->Filter), AddressX(CompatibleTexture->AddressX), AddressY(CompatibleTexture->AddressY), bUseSRGB(CompatibleTexture->SRGB),
+		Filter(CompatibleTexture->Filter), AddressX(CompatibleTexture->AddressX), AddressY(CompatibleTexture->AddressY), bUseSRGB(CompatibleTexture->SRGB), bCompressSourceArt(CompatibleTexture->Source.IsPNGCompressed()),
 		CompressionSettings(CompatibleTexture->CompressionSettings), bCompressWithoutAlpha(CompatibleTexture->CompressionNoAlpha),
 		LossyCompressionAmount(CompatibleTexture->LossyCompressionAmount), MaxTextureSize(CompatibleTexture->MaxTextureSize),
-		CompressionQuality(CompatibleTexture->CompressionQuality), LODBias(CompatibleTexture->LODBias)
+		CompressionQuality(CompatibleTexture->CompressionQuality), LODBias(CompatibleTexture->LODBias),
+		TileSize(0), TileOrigin(0, 0), TileDimensions(0, 0), TileUVOffset(0.0f, 0.0f), TileUVScale(1.0f, 1.0f),
+		Destination(ETBOutputDestination::Asset), ExportFileFormat(ETBImageFileFormat::PNG)
 	{}
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Image)
@@ -51,6 +87,17 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Image)
 	TEnumAsByte<enum TextureMipGenSettings> MipGenSettings;
 
+	/** Store the whole mip chain in the source art, filtered in linear space. The texture then uses TMGS_LeaveExistingMips instead of MipGenSettings. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Image)
+	bool bGenerateSourceMips;
+
+	/** Rescale alpha of generated mips, so the share of pixels above AlphaCoverageThreshold stays the same as in the top mip */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Image, meta = (EditCondition = "bGenerateSourceMips"))
+	bool bPreserveAlphaCoverage;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Image, meta = (EditCondition = "bPreserveAlphaCoverage", ClampMin = "0.0", ClampMax = "1.0"))
+	float AlphaCoverageThreshold;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Format)
 	TEnumAsByte<enum ETextureSourceFormat> OutputImageFormat;
 
@@ -71,6 +118,10 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Format)
 	bool bUseSRGB;
 
+	/** Store source art PNG compressed, encoded on a worker thread. Only a single G8, BGRA8, RGBA8 or RGBA16 mip can be stored this way, other sources stay raw */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Format)
+	bool bCompressSourceArt;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Compression)
 	TEnumAsByte<enum TextureCompressionSettings> CompressionSettings;
 
@@ -93,8 +144,38 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=LevelOfDetail, meta=(DisplayName="LOD Bias"), AssetRegistrySearchable)
 	int32 LODBias;
 
+	/** Render the output in tiles of at most this size, so memory use depends on the tile size only. 0 renders the whole output at once. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Tiling, meta = (ClampMin = "0", ClampMax = "4096"))
+	int32 TileSize;
+
+	/** Pixel rectangle of the output covered by the tile being rendered. Canvas coordinates are already offset by it. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Transient, Category = Tiling)
+	FIntPoint TileOrigin;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Transient, Category = Tiling)
+	FIntPoint TileDimensions;
+
+	/** Output UV range covered by the tile being rendered: UV = TileUVOffset + TileUV * TileUVScale */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Transient, Category = Tiling)
+	FVector2D TileUVOffset;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Transient, Category = Tiling)
+	FVector2D TileUVScale;
+
+	/** Where the baked image goes. Image files skip texture creation and are encoded on worker threads */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Output)
+	ETBOutputDestination Destination;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Output, meta = (EditCondition = "Destination == ETBOutputDestination::ImageFile"))
+	ETBImageFileFormat ExportFileFormat;
+
+	static constexpr int32 MaxOutputSize = 4096;
+	static constexpr int32 MaxTiledOutputSize = 16384;
 
 	FString ToString() const;
+	bool IsTiled() const { return TileSize > 0; }
+	void SetTile(const FIntRect& TileRect);
+	FTextureBakerSourceMipSettings GetSourceMipSettings() const;
 	ETextureRenderTargetFormat GetRenderTargetFormat() const;
 	EPixelFormat GetPixelFormat() const;
 	bool IsValid() const;
@@ -118,32 +199,38 @@ struct TEXTUREBAKER_API FTextureBakerResourceRequirements
 	TEnumAsByte<TextureMipGenSettings> MipGenSettings;
 
 	bool IsSatisfiedByTexture(UTexture2D* Texture, const FTextureSource& OriginalArtData) const;
+	bool operator==(const FTextureBakerResourceRequirements& Lhs) const { return bUseImportedResolution == Lhs.bUseImportedResolution && bRequireUncompressed == Lhs.bRequireUncompressed && MipGenSettings == Lhs.MipGenSettings; }
 	friend inline uint32 GetTypeHash(const FTextureBakerResourceRequirements& Key) { return HashCombine(GetTypeHash(Key.MipGenSettings), (Key.bUseImportedResolution ? 0 : 1) + (Key.bRequireUncompressed ? 0 : 2)); };
 };
 
+// Derived art is shared by sources with the same content, whatever texture they belong to
 USTRUCT()
 struct TEXTUREBAKER_API FTextureBakerDerivedArtKey : public FTextureBakerResourceRequirements
 {
 	GENERATED_BODY()
 
 public:
-	FTextureBakerDerivedArtKey() : FTextureBakerResourceRequirements(), SourceImageSize(0, 0), SourceFormat(ETextureSourceFormat::TSF_Invalid), SourceArtGUID() {}
+	FTextureBakerDerivedArtKey() : FTextureBakerResourceRequirements(), SourceImageSize(0, 0), SourceFormat(ETextureSourceFormat::TSF_Invalid), SourceContentHash() {}
 	FTextureBakerDerivedArtKey(const FTextureBakerDerivedArtKey& Lhs) = default;
-	FTextureBakerDerivedArtKey(const FTextureBakerResourceRequirements& Requirements, const FTextureSource& SourceArt) : FTextureBakerResourceRequirements(Requirements)
+	FTextureBakerDerivedArtKey(const FTextureBakerResourceRequirements& Requirements, const FTextureSource& SourceArt, const FGuid& InSourceContentHash) : FTextureBakerResourceRequirements(Requirements)
 	{
 		SourceImageSize = FIntPoint(SourceArt.GetSizeX(), SourceArt.GetSizeY());
 		SourceFormat = SourceArt.GetFormat();
-		SourceArtGUID = SourceArt.GetId();
+		SourceContentHash = InSourceContentHash;
 	}
 
 	FTextureBakerDerivedArtKey& operator=(const FTextureBakerDerivedArtKey& Lhs) = default;
+	const FGuid& GetSourceContentHash() const { return SourceContentHash; }
 	bool operator!=(const FTextureBakerDerivedArtKey& Lhs) const { return !(*this == Lhs); }
-	bool operator==(const FTextureBakerDerivedArtKey& Lhs) const { return SourceImageSize == Lhs.SourceImageSize && SourceFormat == Lhs.SourceFormat && SourceArtGUID == Lhs.SourceArtGUID;	}
+	bool operator==(const FTextureBakerDerivedArtKey& Lhs) const 
+	{ 
+		return FTextureBakerResourceRequirements::operator==(Lhs) && SourceImageSize == Lhs.SourceImageSize && SourceFormat == Lhs.SourceFormat && SourceContentHash == Lhs.SourceContentHash;
+	}
 
 	friend inline uint32 GetTypeHash(const FTextureBakerDerivedArtKey& Key) { 
 		return HashCombine(
 			HashCombine(GetTypeHash(static_cast<const FTextureBakerResourceRequirements&>(Key)), GetTypeHash(Key.SourceImageSize)),
-			HashCombine(GetTypeHash(Key.SourceFormat), GetTypeHash(Key.SourceArtGUID))
+			HashCombine(GetTypeHash(Key.SourceFormat), GetTypeHash(Key.SourceContentHash))
 		); 
 	};
 
@@ -155,18 +242,37 @@ protected:
 	UPROPERTY()
 	TEnumAsByte<ETextureSourceFormat> SourceFormat;
 
+	// MD5 of all source mips
 	UPROPERTY()
-	FGuid SourceArtGUID;
+	FGuid SourceContentHash;
 };
 
 
+// Time a temporary render target was needed by a render scope. Every temporary would stay allocated until ScopeEnd without reuse
+struct FTextureBakerTransientLifetime
+{
+	double FirstUse;
+	double LastUse;
+	double ScopeEnd;
+	int64 Bytes;
+};
+
 class TEXTUREBAKER_API ITextureBakerRTPool
 {
 public:
 	virtual UTexture2D* GetOrCreateDerivedArt(UTexture2D* Source, const FTextureBakerResourceRequirements& Options) = 0;
-	virtual UTextureRenderTarget2D* GetOrCreateRT(const FIntPoint& InTargetSize, ETextureRenderTargetFormat Format) = 0;
+	// Pooled render targets keep their resource and content, ClearColor is the clear value of a newly created one
+	virtual UTextureRenderTarget2D* GetOrCreateRT(const FIntPoint& InTargetSize, ETextureRenderTargetFormat Format, bool bAutoGenerateMips, const FLinearColor& ClearColor) = 0;
 	virtual UCanvas* GetOrCreateCanvas() = 0;
 	virtual bool ReleaseObject(UObject* Object) = 0;
+	virtual TSharedPtr<FTextureBakerPendingReadback> BeginReadback(UTextureRenderTarget2D* SourceRT, ETextureSourceFormat ImageFormat, ETBImageNormalization Normalization) = 0;
+	virtual FTextureBakerReadbackArena* GetReadbackArena() = 0;
+	// Queue for asynchronous builds of temporary textures, nullptr if they're built synchronously
+	virtual FTextureBakerCompressionQueue* GetTextureBuildQueue() = 0;
+	// Lifetimes of temporary render targets of a finished render scope
+	virtual void AddTransientLifetimes(const TArray<FTextureBakerTransientLifetime>& Lifetimes) = 0;
+	// Derived art drops its source copy once it's built. Returns the texture it was created from, Texture itself for any other texture
+	virtual UTexture2D* GetDerivedArtOriginal(UTexture2D* Texture) = 0;
 };
 
 enum class ETBDerivedArtMode : uint8
@@ -87,6 +87,13 @@ public:
 
 	/* Overrides */
 	virtual bool IsEditorOnly() const {	return true; }
+
+	/* Settings */
+
+	// Build temporary textures and derived art asynchronously, so independent intermediates are compressed in parallel while draws go on.
+	// Such textures have to be passed through PrepareTexture, PrepareTextures or a Prepare*Material call before they're drawn
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Rendering)
+	bool bDeferTemporaryTextureBuilds = false;
 	
 	/* Events */
 
@@ -112,6 +119,10 @@ protected:
 	UFUNCTION(BlueprintCallable, Category = "TextureBaker|Streaming")
 	UTexture2D* PrepareTexture(UTexture2D* SourceTexture, const FTextureBakerResourceRequirements& Options);
 
+	// Fully stream textures in. Derived art of all textures is built in parallel when temporary texture builds are deferred
+	UFUNCTION(BlueprintCallable, Category = "TextureBaker|Streaming")
+	TArray<UTexture2D*> PrepareTextures(const TArray<UTexture2D*>& SourceTextures, const FTextureBakerResourceRequirements& Options);
+
 	// Fully stream material in (SetForceMipLevelsToBeResident)
 	UFUNCTION(BlueprintCallable, Category = "TextureBaker|Streaming")
 	UMaterialInterface* PrepareMaterial(UMaterialInterface* SourceMaterial);
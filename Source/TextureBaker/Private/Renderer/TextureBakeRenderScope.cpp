@@ -1,7 +1,7 @@
 #include "Renderer/TextureBakerRenderScope.h"
 #include "TextureBaker.h"
+#include "TextureBakerCompression.h"
 #include "Engine/Canvas.h"
-#include "ClearQuad.h"
 
 FTextureBakerDrawTarget::FTextureBakerDrawTarget(UTextureRenderTarget2D* RenderTarget, ERHIFeatureLevel::Type FeatureLevel ) :
 	RenderTargetObject(RenderTarget), 
@@ -38,6 +38,19 @@ void FTextureBakerDrawTarget::InitializeCanvasObject(UCanvas* Canvas)
 		});
 }
 
+void FTextureBakerDrawTarget::SetTileViewport(UCanvas* Canvas, const FIntPoint& OutputSize, const FIntPoint& TileOrigin)
+{
+	// Canvas keeps the output size and coordinates, so draws land in the tile as they would in the whole output
+	Canvas->Init(OutputSize.X, OutputSize.Y, nullptr, &RenderCanvas);
+	Canvas->Update();
+	RenderCanvas.PushAbsoluteTransform(FTranslationMatrix(FVector(-TileOrigin.X, -TileOrigin.Y, 0.0f)));
+}
+
+bool FTextureBakerDrawTarget::HasPendingDraws() const
+{
+	return RenderCanvas.HasBatchesToRender();
+}
+
 void FTextureBakerDrawTarget::WaitDrawCompletion()
 {
 	if (DrawEvent && RenderTargetObject)
@@ -191,7 +204,15 @@ UTexture2D* FTextureBakerRenderScope::CreateTemporaryTexture(UTextureRenderTarge
 			if (UTexture2D* OutTexture = UTexture2D::CreateTransient(InTargetSize.X, InTargetSize.Y, PixelFormat))
 			{
 				OutTexture->MipGenSettings = MipFilter;
-				FTextureBakerModule::GetChecked().WriteTexture2DSourceArt(OutTexture, ImageFormat, SourceRT, Normalization);
+				TSharedPtr<FTextureBakerPendingReadback> PendingReadback = RTPool->BeginReadback(SourceRT, ImageFormat, Normalization);
+				FTextureBakerCompressionQueue* BuildQueue = RTPool->GetTextureBuildQueue();
+				FTextureBakerModule::GetChecked().WriteTexture2DSourceArt(OutTexture, ImageFormat, SourceRT, Normalization, PendingReadback.Get(), RTPool->GetReadbackArena(),
+					FTextureBakerSourceMipSettings(), BuildQueue == nullptr);
+				if (BuildQueue)
+				{
+					BuildQueue->Tick();
+					BuildQueue->Add(OutTexture, false);
+				}
 				TemporaryTextures.Add(OutTexture);
 				return OutTexture;
 			}
@@ -200,17 +221,35 @@ UTexture2D* FTextureBakerRenderScope::CreateTemporaryTexture(UTextureRenderTarge
 	return nullptr;
 }
 
+void FTextureBakerRenderScope::WaitForTexture(UTexture2D* Texture)
+{
+	if (!Texture)
+	{
+		return;
+	}
+	ITextureBakerRTPool* RTPool = GetRenderTargetPool();
+	FTextureBakerCompressionQueue* BuildQueue = RTPool ? RTPool->GetTextureBuildQueue() : nullptr;
+	if ((!BuildQueue || !BuildQueue->WaitFor(Texture)) && !Texture->IsAsyncCacheComplete())
+	{
+		// Shared derived art may still be built by the queue of another render context, even if this one builds synchronously
+		Texture->FinishCachePlatformData();
+		Texture->UpdateResource();
+	}
+}
+
 UTexture2D* FTextureBakerRenderScope::ConditionallyCreateDerivedArt(UTexture2D* SourceTexture, const FTextureBakerResourceRequirements& Options, ETBDerivedArtMode Mode)
 {
 	if (SourceTexture)
 	{
-		if (!EnumHasAllFlags(Mode, ETBDerivedArtMode::AlwaysCreate) && Options.IsSatisfiedByTexture(SourceTexture, SourceTexture->Source))
+		// Derived art passed back in is checked and recreated from its original, it has no source to compare with
+		UTexture2D* OriginalTexture = GetDerivedArtOriginal(SourceTexture);
+		if (!EnumHasAllFlags(Mode, ETBDerivedArtMode::AlwaysCreate) && Options.IsSatisfiedByTexture(OriginalTexture, OriginalTexture->Source))
 		{
-			return SourceTexture;
+			return OriginalTexture;
 		}
 		else if (ITextureBakerRTPool* RTPool = GetRenderTargetPool())
 		{
-			if (UTexture2D* DerivedArt = RTPool->GetOrCreateDerivedArt(SourceTexture, Options))
+			if (UTexture2D* DerivedArt = RTPool->GetOrCreateDerivedArt(OriginalTexture, Options))
 			{
 				TemporaryTextures.Add(DerivedArt);
 				return DerivedArt;
@@ -220,14 +259,21 @@ UTexture2D* FTextureBakerRenderScope::ConditionallyCreateDerivedArt(UTexture2D*
 	return EnumHasAllFlags(Mode, ETBDerivedArtMode::Failsafe) ? SourceTexture : nullptr;
 }
 
+UTexture2D* FTextureBakerRenderScope::GetDerivedArtOriginal(UTexture2D* Texture) const
+{
+	ITextureBakerRTPool* RTPool = GetRenderTargetPool();
+	return RTPool ? RTPool->GetDerivedArtOriginal(Texture) : Texture;
+}
+
 UTextureRenderTarget2D* FTextureBakerRenderScope::CreateTemporaryRT(const FIntPoint& InTargetSize, ETextureRenderTargetFormat Format, FLinearColor ClearColor, bool bAutoGenerateMipMaps)
 {
 	if (ITextureBakerRTPool* RTPool = GetRenderTargetPool())
 	{
-		UTextureRenderTarget2D* AllocatedRT = RTPool->GetOrCreateRT(InTargetSize, Format);
+		UTextureRenderTarget2D* AllocatedRT = RTPool->GetOrCreateRT(InTargetSize, Format, bAutoGenerateMipMaps, ClearColor);
 		check(AllocatedRT);
 		AllocatedRT->ClearColor = ClearColor;
-		AllocatedRT->bAutoGenerateMips = bAutoGenerateMipMaps;
+		FTextureBakerRenderTargetPool::Clear(AllocatedRT, ClearColor);
+		BeginTransientLifetime(AllocatedRT);
 		return AllocatedRT;
 	}
 	return nullptr;
@@ -237,22 +283,12 @@ UCanvas* FTextureBakerRenderScope::CreateTemporaryDrawRT(const FIntPoint& InTarg
 {
 	if (ITextureBakerRTPool* RTPool = GetRenderTargetPool())
 	{
-		UTextureRenderTarget2D* AllocatedRT = RTPool->GetOrCreateRT(InTargetSize, Format);
+		// Pooled render target keeps its resource, only its content is cleared
+		UTextureRenderTarget2D* AllocatedRT = RTPool->GetOrCreateRT(InTargetSize, Format, bAutoGenerateMipMaps, ClearColor);
 		check(AllocatedRT);
 		AllocatedRT->ClearColor = ClearColor;
-		AllocatedRT->bAutoGenerateMips = bAutoGenerateMipMaps;
-		AllocatedRT->UpdateResource();
-
-		FTextureRenderTargetResource* RenderTargetResource = AllocatedRT->GameThread_GetRenderTargetResource();
-		ENQUEUE_RENDER_COMMAND(ClearRTCommand)(
-			[RenderTargetResource, ClearColor](FRHICommandList& RHICmdList)
-			{
-				FRHIRenderPassInfo RPInfo(RenderTargetResource->GetRenderTargetTexture(), ERenderTargetActions::DontLoad_Store);
-				TransitionRenderPassTargets(RHICmdList, RPInfo);
-				RHICmdList.BeginRenderPass(RPInfo, TEXT("ClearRT"));
-				DrawClearQuad(RHICmdList, ClearColor);
-				RHICmdList.EndRenderPass();
-			});
+		FTextureBakerRenderTargetPool::Clear(AllocatedRT, ClearColor);
+		BeginTransientLifetime(AllocatedRT);
 
 		const ERHIFeatureLevel::Type FeatureLevel = GMaxRHIFeatureLevel;
 		UCanvas* RenderCanvas = RTPool->GetOrCreateCanvas();
@@ -263,6 +299,22 @@ UCanvas* FTextureBakerRenderScope::CreateTemporaryDrawRT(const FIntPoint& InTarg
 	return nullptr;
 }
 
+UCanvas* FTextureBakerRenderScope::CreateTemporaryDrawTile(const FIntPoint& OutputSize, const FIntRect& TileRect, ETextureRenderTargetFormat Format, FLinearColor ClearColor)
+{
+	if (UCanvas* RenderCanvas = CreateTemporaryDrawRT(TileRect.Size(), Format, ClearColor, false))
+	{
+		ActiveDrawTargets.FindChecked(RenderCanvas).SetTileViewport(RenderCanvas, OutputSize, TileRect.Min);
+		return RenderCanvas;
+	}
+	return nullptr;
+}
+
+bool FTextureBakerRenderScope::HasPendingDraws(UCanvas* DrawTarget) const
+{
+	const FTextureBakerDrawTarget* DrawContext = ActiveDrawTargets.Find(DrawTarget);
+	return DrawContext && DrawContext->HasPendingDraws();
+}
+
 UTexture2D* FTextureBakerRenderScope::ResolveTemporaryDrawRT(UCanvas* DrawTarget, TextureMipGenSettings MipGenSettings, ETBImageNormalization Normalization)
 {
 	if (FTextureBakerDrawTarget* DrawContext = ActiveDrawTargets.Find(DrawTarget))
@@ -291,9 +343,43 @@ UTextureRenderTarget2D* FTextureBakerRenderScope::ResolveTemporaryDrawRT_AsRende
 	return nullptr;
 }
 
+void FTextureBakerRenderScope::BeginTransientLifetime(UTextureRenderTarget2D* RenderTarget)
+{
+	const double Now = FPlatformTime::Seconds();
+	OpenTransientLifetimes.Add(RenderTarget, { Now, Now, 0.0, int64(RenderTarget->CalcTextureMemorySizeEnum(TMC_AllMips)) });
+}
+
+void FTextureBakerRenderScope::EndTransientLifetime(UTextureRenderTarget2D* RenderTarget)
+{
+	FTextureBakerTransientLifetime Lifetime;
+	if (RenderTarget && OpenTransientLifetimes.RemoveAndCopyValue(RenderTarget, Lifetime))
+	{
+		Lifetime.LastUse = FPlatformTime::Seconds();
+		TransientLifetimes.Add(Lifetime);
+	}
+}
+
+void FTextureBakerRenderScope::GetTransientLifetimes(TArray<FTextureBakerTransientLifetime>& OutLifetimes) const
+{
+	// Render targets handed out of the scope are needed until it ends
+	const double Now = FPlatformTime::Seconds();
+	for (const FTextureBakerTransientLifetime& Lifetime : TransientLifetimes)
+	{
+		OutLifetimes.Add({ Lifetime.FirstUse, Lifetime.LastUse, Now, Lifetime.Bytes });
+	}
+	for (const TPair<UTextureRenderTarget2D*, FTextureBakerTransientLifetime>& OpenLifetime : OpenTransientLifetimes)
+	{
+		OutLifetimes.Add({ OpenLifetime.Value.FirstUse, Now, Now, OpenLifetime.Value.Bytes });
+	}
+}
+
 bool FTextureBakerRenderScope::ReleaseTemporaryResource(UObject* ResourceObject)
 {
 	bool bResult = false;
+	if (UTextureRenderTarget2D* RenderTarget = Cast<UTextureRenderTarget2D>(ResourceObject))
+	{
+		EndTransientLifetime(RenderTarget);
+	}
 	if (ITextureBakerRTPool* RTPool = GetRenderTargetPool())
 	{
 		bResult |= RTPool->ReleaseObject(ResourceObject);
@@ -303,6 +389,7 @@ bool FTextureBakerRenderScope::ReleaseTemporaryResource(UObject* ResourceObject)
 		int32 TextureIndex = INDEX_NONE;
 		if (TemporaryTextures.Find(SourceTexture, TextureIndex))
 		{
+			WaitForTexture(SourceTexture);
 			TemporaryTextures[TextureIndex]->ReleaseResource();
 			TemporaryTextures.RemoveAt(TextureIndex);
 			bResult = true;
@@ -341,4 +428,13 @@ FTextureBakerRenderScope::~FTextureBakerRenderScope()
 		UTexture2D* StreamedTexture = ResidentTextureInfo.Key;
 		ResidentTextureInfo.Value.Revert(StreamedTexture);
 	}
+
+	// Root scope lives as long as the render context, which reads its lifetimes directly
+	ITextureBakerRTPool* RTPool = GetRenderTargetPool();
+	if (RTPool && ParentRenderScope.IsValid())
+	{
+		TArray<FTextureBakerTransientLifetime> ScopeLifetimes;
+		GetTransientLifetimes(ScopeLifetimes);
+		RTPool->AddTransientLifetimes(ScopeLifetimes);
+	}
 }
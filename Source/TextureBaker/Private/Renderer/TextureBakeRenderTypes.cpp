@@ -1,4 +1,5 @@
 #include "Renderer/TextureBakerRenderTypes.h"
+#include "TextureBakerImageExport.h"
 
 FString FTextureBakerOutputInfo::ToString() const
 {
@@ -21,7 +22,34 @@ EPixelFormat FTextureBakerOutputInfo::GetPixelFormat() const
 
 bool FTextureBakerOutputInfo::IsValid() const
 {
-	return OutputDimensions.GetMin() > 0 && OutputDimensions.GetMax() <= 4096 && OutputImageFormat != ETextureSourceFormat::TSF_Invalid;
+	if (Destination == ETBOutputDestination::ImageFile && !FTextureBakerImageExporter::SupportsFormat(ExportFileFormat, OutputImageFormat))
+	{
+		return false;
+	}
+	if (IsTiled())
+	{
+		// Auto normalization needs the range of the whole image, a tile only knows its own
+		return OutputDimensions.GetMin() > 0 && OutputDimensions.GetMax() <= MaxTiledOutputSize && TileSize <= MaxOutputSize
+			&& OutputImageFormat != ETextureSourceFormat::TSF_Invalid && Normalization != ETBImageNormalization::Auto;
+	}
+	return OutputDimensions.GetMin() > 0 && OutputDimensions.GetMax() <= MaxOutputSize && OutputImageFormat != ETextureSourceFormat::TSF_Invalid;
+}
+
+void FTextureBakerOutputInfo::SetTile(const FIntRect& TileRect)
+{
+	TileOrigin = TileRect.Min;
+	TileDimensions = TileRect.Size();
+	TileUVOffset = FVector2D(float(TileOrigin.X) / OutputDimensions.X, float(TileOrigin.Y) / OutputDimensions.Y);
+	TileUVScale = FVector2D(float(TileDimensions.X) / OutputDimensions.X, float(TileDimensions.Y) / OutputDimensions.Y);
+}
+
+FTextureBakerSourceMipSettings FTextureBakerOutputInfo::GetSourceMipSettings() const
+{
+	FTextureBakerSourceMipSettings Settings;
+	Settings.bGenerateMips = bGenerateSourceMips;
+	Settings.bPreserveAlphaCoverage = bPreserveAlphaCoverage;
+	Settings.AlphaCoverageThreshold = AlphaCoverageThreshold;
+	return Settings;
 }
 
 void FTextureBakerOutputInfo::SetTextureAttributes(UTexture2D* Texture) const
@@ -0,0 +1,317 @@
+#include "Renderer/TextureBakerDerivedArtCache.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "EngineLogs.h"
+
+static TAutoConsoleVariable<int32> CVarTextureBakerDerivedArtCache(
+	TEXT("TextureBaker.DerivedArtCache.Enable"),
+	1,
+	TEXT("Keep source art of derived art on disk between editor sessions, so known sources aren't decompressed again."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTextureBakerDerivedArtCacheSize(
+	TEXT("TextureBaker.DerivedArtCache.SizeMB"),
+	4096,
+	TEXT("Disk space (in MB) the derived art cache may take. Least recently used files are deleted once it's exceeded."),
+	ECVF_Default);
+
+static const TCHAR* SourceArtExtension = TEXT(".tbsrc");
+static const TCHAR* ContentHashesFileName = TEXT("ContentHashes.bin");
+static constexpr uint32 SourceArtMagic = 0x43525354;	// TSRC
+static constexpr uint32 ContentHashesMagic = 0x48435354;	// TSCH
+static constexpr uint32 CacheVersion = 1;
+
+// Data follows the header right away
+struct FTextureBakerCachedSourceArtHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	int32 SizeX;
+	int32 SizeY;
+	int32 NumMips;
+	int32 Format;
+	int64 DataBytes;
+};
+
+static int64 CalcSourceArtBytes(const FTextureSource& SourceArt)
+{
+	int64 SourceBytes = 0;
+	for (int32 MipIndex = 0; MipIndex < SourceArt.GetNumMips(); MipIndex++)
+	{
+		SourceBytes += SourceArt.CalcMipSize(MipIndex);
+	}
+	return SourceBytes;
+}
+
+FTextureBakerCachedSourceArt::FTextureBakerCachedSourceArt()
+	: Size(0, 0)
+	, NumMips(0)
+	, Format(TSF_Invalid)
+	, Data(nullptr)
+{
+}
+
+FTextureBakerCachedSourceArt::~FTextureBakerCachedSourceArt()
+{
+	Reset();
+}
+
+bool FTextureBakerCachedSourceArt::Matches(const FTextureSource& SourceArt) const
+{
+	return Data && Size == FIntPoint(SourceArt.GetSizeX(), SourceArt.GetSizeY()) && NumMips == SourceArt.GetNumMips() && Format == SourceArt.GetFormat();
+}
+
+void FTextureBakerCachedSourceArt::Reset()
+{
+	// Region has to be unmapped before its file is closed
+	Data = nullptr;
+	MappedRegion.Reset();
+	MappedFile.Reset();
+	StreamedData.Empty();
+}
+
+FTextureBakerDerivedArtCache::FTextureBakerDerivedArtCache()
+	: CachedBytes(0)
+	, NumHits(0)
+	, NumMisses(0)
+	, NumEvicted(0)
+	, bContentHashesDirty(false)
+{
+	if (!IsEnabled())
+	{
+		return;
+	}
+
+	// File time stamps are the use times, they survive the session
+	IFileManager::Get().IterateDirectoryStat(*GetCacheDirectory(), [this](const TCHAR* FileName, const FFileStatData& StatData)
+	{
+		FGuid ContentHash;
+		const FString CleanName = FPaths::GetBaseFilename(FileName);
+		if (!StatData.bIsDirectory && FPaths::GetExtension(FileName, true) == SourceArtExtension && FGuid::Parse(CleanName, ContentHash))
+		{
+			Entries.Add(ContentHash, { StatData.FileSize, StatData.ModificationTime });
+			CachedBytes += StatData.FileSize;
+		}
+		return true;
+	});
+	LoadContentHashes();
+}
+
+FTextureBakerDerivedArtCache::~FTextureBakerDerivedArtCache()
+{
+	Flush();
+}
+
+bool FTextureBakerDerivedArtCache::IsEnabled()
+{
+	return CVarTextureBakerDerivedArtCache.GetValueOnAnyThread() != 0;
+}
+
+FGuid FTextureBakerDerivedArtCache::CalcContentHash(const FTextureSource& SourceArt, const uint8* SourceData)
+{
+	FMD5 MD5;
+	MD5.Update(SourceData, CalcSourceArtBytes(SourceArt));
+	uint32 Digest[4];
+	MD5.Final(reinterpret_cast<uint8*>(Digest));
+	return FGuid(Digest[0], Digest[1], Digest[2], Digest[3]);
+}
+
+FString FTextureBakerDerivedArtCache::GetCacheDirectory() const
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("TextureBaker"), TEXT("DerivedArt"));
+}
+
+FString FTextureBakerDerivedArtCache::GetSourceArtFileName(const FGuid& ContentHash) const
+{
+	return FPaths::Combine(GetCacheDirectory(), ContentHash.ToString() + SourceArtExtension);
+}
+
+bool FTextureBakerDerivedArtCache::FindContentHash(const FGuid& SourceId, FGuid& OutContentHash) const
+{
+	FScopeLock ScopeLock(&Lock);
+	if (const FGuid* ContentHash = ContentHashes.Find(SourceId))
+	{
+		OutContentHash = *ContentHash;
+		return true;
+	}
+	return false;
+}
+
+void FTextureBakerDerivedArtCache::AddContentHash(const FGuid& SourceId, const FGuid& ContentHash)
+{
+	FScopeLock ScopeLock(&Lock);
+	ContentHashes.Add(SourceId, ContentHash);
+	bContentHashesDirty = true;
+}
+
+bool FTextureBakerDerivedArtCache::LoadSourceArt(const FGuid& ContentHash, FTextureBakerCachedSourceArt& OutSourceArt)
+{
+	FScopeLock ScopeLock(&Lock);
+	OutSourceArt.Reset();
+	FCacheEntry* Entry = Entries.Find(ContentHash);
+	if (!Entry)
+	{
+		return false;
+	}
+
+	const FString FileName = GetSourceArtFileName(ContentHash);
+	FTextureBakerCachedSourceArtHeader Header;
+	bool bLoaded = false;
+	OutSourceArt.MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*FileName));
+	if (OutSourceArt.MappedFile.IsValid() && OutSourceArt.MappedFile->GetFileSize() >= int64(sizeof(Header)))
+	{
+		OutSourceArt.MappedRegion.Reset(OutSourceArt.MappedFile->MapRegion(0, OutSourceArt.MappedFile->GetFileSize(), true));
+		if (OutSourceArt.MappedRegion.IsValid())
+		{
+			FMemory::Memcpy(&Header, OutSourceArt.MappedRegion->GetMappedPtr(), sizeof(Header));
+			bLoaded = (Header.DataBytes >= 0 && OutSourceArt.MappedRegion->GetMappedSize() >= int64(sizeof(Header)) + Header.DataBytes);
+			OutSourceArt.Data = OutSourceArt.MappedRegion->GetMappedPtr() + sizeof(Header);
+		}
+	}
+	else if (TUniquePtr<FArchive> Reader = TUniquePtr<FArchive>(IFileManager::Get().CreateFileReader(*FileName)))
+	{
+		// Platform can't map files, data is streamed into memory instead
+		Reader->Serialize(&Header, sizeof(Header));
+		if (!Reader->IsError() && Header.DataBytes >= 0 && Reader->TotalSize() >= int64(sizeof(Header)) + Header.DataBytes)
+		{
+			OutSourceArt.StreamedData.SetNumUninitialized(Header.DataBytes);
+			Reader->Serialize(OutSourceArt.StreamedData.GetData(), Header.DataBytes);
+			bLoaded = !Reader->IsError();
+			OutSourceArt.Data = OutSourceArt.StreamedData.GetData();
+		}
+	}
+
+	if (!bLoaded || Header.Magic != SourceArtMagic || Header.Version != CacheVersion)
+	{
+		UE_LOG(LogTexture, Warning, TEXT("Derived art cache file %s is unreadable and will be rebuilt"), *FileName);
+		OutSourceArt.Reset();
+		IFileManager::Get().Delete(*FileName, false, true, true);
+		CachedBytes -= Entry->Bytes;
+		Entries.Remove(ContentHash);
+		return false;
+	}
+
+	OutSourceArt.Size = FIntPoint(Header.SizeX, Header.SizeY);
+	OutSourceArt.NumMips = Header.NumMips;
+	OutSourceArt.Format = ETextureSourceFormat(Header.Format);
+	Entry->LastUse = FDateTime::UtcNow();
+	IFileManager::Get().SetTimeStamp(*FileName, Entry->LastUse);
+	NumHits++;
+	return true;
+}
+
+void FTextureBakerDerivedArtCache::StoreSourceArt(const FGuid& ContentHash, const FTextureSource& SourceArt, const uint8* SourceData)
+{
+	FScopeLock ScopeLock(&Lock);
+	NumMisses++;
+	if (!SourceData || Entries.Contains(ContentHash))
+	{
+		return;
+	}
+
+	const int64 BudgetBytes = int64(FMath::Max(0, CVarTextureBakerDerivedArtCacheSize.GetValueOnAnyThread())) * 1024 * 1024;
+	FTextureBakerCachedSourceArtHeader Header;
+	Header.Magic = SourceArtMagic;
+	Header.Version = CacheVersion;
+	Header.SizeX = SourceArt.GetSizeX();
+	Header.SizeY = SourceArt.GetSizeY();
+	Header.NumMips = SourceArt.GetNumMips();
+	Header.Format = int32(SourceArt.GetFormat());
+	Header.DataBytes = CalcSourceArtBytes(SourceArt);
+	const int64 FileBytes = int64(sizeof(Header)) + Header.DataBytes;
+	if (FileBytes > BudgetBytes)
+	{
+		return;
+	}
+
+	// Written under a temporary name, so an interrupted write never looks like a valid entry
+	const FString FileName = GetSourceArtFileName(ContentHash);
+	const FString TempFileName = FileName + TEXT(".tmp");
+	bool bWritten = false;
+	if (TUniquePtr<FArchive> Writer = TUniquePtr<FArchive>(IFileManager::Get().CreateFileWriter(*TempFileName)))
+	{
+		Writer->Serialize(&Header, sizeof(Header));
+		Writer->Serialize(const_cast<uint8*>(SourceData), Header.DataBytes);
+		bWritten = Writer->Close();
+	}
+	if (!bWritten || !IFileManager::Get().Move(*FileName, *TempFileName))
+	{
+		IFileManager::Get().Delete(*TempFileName, false, true, true);
+		UE_LOG(LogTexture, Warning, TEXT("Failed to write derived art cache file %s"), *FileName);
+		return;
+	}
+
+	Entries.Add(ContentHash, { FileBytes, FDateTime::UtcNow() });
+	CachedBytes += FileBytes;
+	Trim(BudgetBytes);
+}
+
+void FTextureBakerDerivedArtCache::Trim(int64 BudgetBytes)
+{
+	if (CachedBytes <= BudgetBytes)
+	{
+		return;
+	}
+
+	Entries.ValueSort([](const FCacheEntry& A, const FCacheEntry& B) { return A.LastUse < B.LastUse; });
+	for (auto It = Entries.CreateIterator(); It && CachedBytes > BudgetBytes; ++It)
+	{
+		IFileManager::Get().Delete(*GetSourceArtFileName(It.Key()), false, true, true);
+		CachedBytes -= It.Value().Bytes;
+		It.RemoveCurrent();
+		NumEvicted++;
+	}
+}
+
+void FTextureBakerDerivedArtCache::LoadContentHashes()
+{
+	TUniquePtr<FArchive> Reader = TUniquePtr<FArchive>(IFileManager::Get().CreateFileReader(*FPaths::Combine(GetCacheDirectory(), ContentHashesFileName)));
+	if (!Reader.IsValid())
+	{
+		return;
+	}
+
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	*Reader << Magic << Version;
+	if (Magic == ContentHashesMagic && Version == CacheVersion)
+	{
+		*Reader << ContentHashes;
+	}
+	if (Reader->IsError())
+	{
+		ContentHashes.Reset();
+	}
+}
+
+void FTextureBakerDerivedArtCache::ResetStats()
+{
+	FScopeLock ScopeLock(&Lock);
+	NumHits = 0;
+	NumMisses = 0;
+	NumEvicted = 0;
+}
+
+void FTextureBakerDerivedArtCache::Flush()
+{
+	FScopeLock ScopeLock(&Lock);
+	if (!bContentHashesDirty || !IsEnabled())
+	{
+		return;
+	}
+
+	const FString FileName = FPaths::Combine(GetCacheDirectory(), ContentHashesFileName);
+	if (TUniquePtr<FArchive> Writer = TUniquePtr<FArchive>(IFileManager::Get().CreateFileWriter(*FileName)))
+	{
+		uint32 Magic = ContentHashesMagic;
+		uint32 Version = CacheVersion;
+		*Writer << Magic << Version;
+		*Writer << ContentHashes;
+		bContentHashesDirty = !Writer->Close();
+	}
+}
@@ -0,0 +1,295 @@
+#include "Renderer/TextureBakerMips.h"
+#include "Async/ParallelFor.h"
+#include "Math/Float16Color.h"
+
+namespace TextureBakerMips
+{
+	static constexpr int32 RowsPerTask = 16;
+	static constexpr int32 CoverageSearchSteps = 10;
+	static constexpr float MaxCoverageScale = 4.0f;
+
+	// Source pixels of one axis contributing to a destination pixel
+	struct FAxisTaps
+	{
+		int32 Index[3];
+		float Weight[3];
+		int32 Num;
+	};
+
+	static FAxisTaps GetAxisTaps(int32 DestIndex, int32 SrcSize)
+	{
+		FAxisTaps Taps;
+		if (SrcSize == 1)
+		{
+			Taps = { { 0, 0, 0 }, { 1.0f, 0.0f, 0.0f }, 1 };
+		}
+		else if (SrcSize % 2 == 0)
+		{
+			Taps = { { DestIndex * 2, DestIndex * 2 + 1, 0 }, { 0.5f, 0.5f, 0.0f }, 2 };
+		}
+		else
+		{
+			Taps = { { DestIndex * 2, DestIndex * 2 + 1, DestIndex * 2 + 2 }, { 0.25f, 0.5f, 0.25f }, 3 };
+		}
+		return Taps;
+	}
+
+	static bool IsGammaEncoded(ETextureSourceFormat Format, bool bSRGB)
+	{
+		return bSRGB && (Format == TSF_G8 || Format == TSF_BGRA8 || Format == TSF_RGBA8);
+	}
+
+	static bool HasAlpha(ETextureSourceFormat Format)
+	{
+		return Format == TSF_BGRA8 || Format == TSF_RGBA8 || Format == TSF_RGBA16 || Format == TSF_RGBA16F;
+	}
+
+	static uint16 ToUNorm16(float Value)
+	{
+		return uint16(FMath::RoundToInt(FMath::Clamp(Value, 0.0f, 1.0f) * 65535.0f));
+	}
+
+	static FLinearColor DecodePixel(ETextureSourceFormat Format, bool bGamma, const uint8* Src)
+	{
+		switch (Format)
+		{
+		case TSF_G8:
+		{
+			const float Value = bGamma ? FLinearColor::sRGBToLinearTable[Src[0]] : Src[0] / 255.0f;
+			return FLinearColor(Value, Value, Value, 1.0f);
+		}
+		case TSF_BGRA8:
+		case TSF_RGBA8:
+		{
+			const bool bBGRA = (Format == TSF_BGRA8);
+			const FColor Color(Src[bBGRA ? 2 : 0], Src[1], Src[bBGRA ? 0 : 2], Src[3]);
+			return bGamma ? FLinearColor(Color) : Color.ReinterpretAsLinear();
+		}
+		case TSF_BGRE8:
+		case TSF_RGBE8:
+		{
+			const bool bBGRA = (Format == TSF_BGRE8);
+			return FColor(Src[bBGRA ? 2 : 0], Src[1], Src[bBGRA ? 0 : 2], Src[3]).FromRGBE();
+		}
+		case TSF_G16:
+		{
+			uint16 Value;
+			FMemory::Memcpy(&Value, Src, sizeof(uint16));
+			return FLinearColor(Value / 65535.0f, Value / 65535.0f, Value / 65535.0f, 1.0f);
+		}
+		case TSF_RGBA16:
+		{
+			uint16 Channels[4];
+			FMemory::Memcpy(Channels, Src, sizeof(Channels));
+			return FLinearColor(Channels[0] / 65535.0f, Channels[1] / 65535.0f, Channels[2] / 65535.0f, Channels[3] / 65535.0f);
+		}
+		case TSF_RGBA16F:
+		{
+			FFloat16Color Color;
+			FMemory::Memcpy(&Color, Src, sizeof(FFloat16Color));
+			return Color.GetFloats();
+		}
+		}
+		return FLinearColor::Black;
+	}
+
+	// Same quantization as the readback encoders, sRGB curve applied to every 8 bit format of a sRGB texture
+	static void EncodePixel(ETextureSourceFormat Format, bool bGamma, const FLinearColor& Color, uint8* Dest)
+	{
+		switch (Format)
+		{
+		case TSF_G8:
+			Dest[0] = Color.ToFColor(bGamma).R;
+			break;
+		case TSF_BGRA8:
+		case TSF_RGBA8:
+		case TSF_BGRE8:
+		case TSF_RGBE8:
+		{
+			const bool bBGRA = (Format == TSF_BGRA8 || Format == TSF_BGRE8);
+			const FColor Encoded = (Format == TSF_BGRA8 || Format == TSF_RGBA8) ? Color.ToFColor(bGamma) : Color.ToRGBE();
+			Dest[0] = bBGRA ? Encoded.B : Encoded.R;
+			Dest[1] = Encoded.G;
+			Dest[2] = bBGRA ? Encoded.R : Encoded.B;
+			Dest[3] = Encoded.A;
+			break;
+		}
+		case TSF_G16:
+		{
+			const uint16 Value = ToUNorm16(Color.R);
+			FMemory::Memcpy(Dest, &Value, sizeof(uint16));
+			break;
+		}
+		case TSF_RGBA16:
+		{
+			const uint16 Channels[4] = { ToUNorm16(Color.R), ToUNorm16(Color.G), ToUNorm16(Color.B), ToUNorm16(Color.A) };
+			FMemory::Memcpy(Dest, Channels, sizeof(Channels));
+			break;
+		}
+		case TSF_RGBA16F:
+		{
+			const FFloat16Color Encoded(Color);
+			FMemory::Memcpy(Dest, &Encoded, sizeof(FFloat16Color));
+			break;
+		}
+		}
+	}
+
+	// GetRow(Y, Scratch) returns SrcSize.X pixels of source row Y, Scratch may be used to hold them
+	template <typename GetRowFunc>
+	static void Downsample(const FIntPoint& SrcSize, const FIntPoint& DestSize, GetRowFunc&& GetRow, FLinearColor* Dest)
+	{
+		ParallelFor(FMath::DivideAndRoundUp(DestSize.Y, RowsPerTask), [&](int32 TaskIndex)
+		{
+			TArray<FLinearColor> Scratch[3];
+			const int32 LastRow = FMath::Min((TaskIndex + 1) * RowsPerTask, DestSize.Y);
+			for (int32 Y = TaskIndex * RowsPerTask; Y < LastRow; Y++)
+			{
+				const FAxisTaps RowTaps = GetAxisTaps(Y, SrcSize.Y);
+				const FLinearColor* Rows[3] = { nullptr, nullptr, nullptr };
+				for (int32 RowTap = 0; RowTap < RowTaps.Num; RowTap++)
+				{
+					Rows[RowTap] = GetRow(RowTaps.Index[RowTap], Scratch[RowTap]);
+				}
+
+				FLinearColor* DestRow = Dest + int64(Y) * DestSize.X;
+				for (int32 X = 0; X < DestSize.X; X++)
+				{
+					const FAxisTaps ColumnTaps = GetAxisTaps(X, SrcSize.X);
+					FLinearColor Sum(0.0f, 0.0f, 0.0f, 0.0f);
+					for (int32 RowTap = 0; RowTap < RowTaps.Num; RowTap++)
+					{
+						for (int32 ColumnTap = 0; ColumnTap < ColumnTaps.Num; ColumnTap++)
+						{
+							Sum += Rows[RowTap][ColumnTaps.Index[ColumnTap]] * (RowTaps.Weight[RowTap] * ColumnTaps.Weight[ColumnTap]);
+						}
+					}
+					DestRow[X] = Sum;
+				}
+			}
+		});
+	}
+
+	// Share of pixels with scaled alpha above the threshold
+	template <typename GetRowFunc>
+	static float ComputeCoverage(const FIntPoint& Size, GetRowFunc&& GetRow, float Threshold, float AlphaScale)
+	{
+		const int32 NumTasks = FMath::DivideAndRoundUp(Size.Y, RowsPerTask);
+		TArray<int64> CoveredPixels;
+		CoveredPixels.SetNumZeroed(NumTasks);
+		ParallelFor(NumTasks, [&](int32 TaskIndex)
+		{
+			TArray<FLinearColor> Scratch;
+			const int32 LastRow = FMath::Min((TaskIndex + 1) * RowsPerTask, Size.Y);
+			for (int32 Y = TaskIndex * RowsPerTask; Y < LastRow; Y++)
+			{
+				const FLinearColor* Row = GetRow(Y, Scratch);
+				for (int32 X = 0; X < Size.X; X++)
+				{
+					CoveredPixels[TaskIndex] += (Row[X].A * AlphaScale > Threshold) ? 1 : 0;
+				}
+			}
+		});
+
+		int64 TotalCovered = 0;
+		for (int64 Covered : CoveredPixels)
+		{
+			TotalCovered += Covered;
+		}
+		return float(double(TotalCovered) / (double(Size.X) * Size.Y));
+	}
+
+	int32 GetNumMips(const FIntPoint& Size)
+	{
+		return FMath::FloorLog2(FMath::Max(FMath::Max(Size.X, Size.Y), 1)) + 1;
+	}
+
+	void GenerateMipChain(FTextureSource& Source, bool bSRGB, const FTextureBakerSourceMipSettings& Settings)
+	{
+		const ETextureSourceFormat Format = Source.GetFormat();
+		const int32 NumMips = Source.GetNumMips();
+		const FIntPoint TopSize(Source.GetSizeX(), Source.GetSizeY());
+		const int64 PixelBytes = FTextureSource::GetBytesPerPixel(Format);
+		const bool bGamma = IsGammaEncoded(Format, bSRGB);
+		const bool bPreserveCoverage = Settings.bPreserveAlphaCoverage && HasAlpha(Format);
+		if (NumMips < 2)
+		{
+			return;
+		}
+
+		const uint8* TopMip = Source.LockMip(0);
+		if (!TopMip)
+		{
+			Source.UnlockMip(0);
+			return;
+		}
+
+		auto DecodeTopRow = [&](int32 Y, TArray<FLinearColor>& Scratch) -> const FLinearColor*
+		{
+			Scratch.SetNumUninitialized(TopSize.X, false);
+			const uint8* Row = TopMip + int64(Y) * TopSize.X * PixelBytes;
+			for (int32 X = 0; X < TopSize.X; X++)
+			{
+				Scratch[X] = DecodePixel(Format, bGamma, Row + X * PixelBytes);
+			}
+			return Scratch.GetData();
+		};
+		const float TargetCoverage = bPreserveCoverage ? ComputeCoverage(TopSize, DecodeTopRow, Settings.AlphaCoverageThreshold, 1.0f) : 0.0f;
+
+		// Each level is filtered from the previous one in float, alpha scale for coverage is applied on encoding only
+		TArray64<FLinearColor> Level;
+		TArray64<FLinearColor> NextLevel;
+		FIntPoint LevelSize = TopSize;
+		for (int32 MipIndex = 1; MipIndex < NumMips; MipIndex++)
+		{
+			const FIntPoint MipSize(FMath::Max(TopSize.X >> MipIndex, 1), FMath::Max(TopSize.Y >> MipIndex, 1));
+			NextLevel.SetNumUninitialized(int64(MipSize.X) * MipSize.Y, false);
+			auto GetLevelRow = [&](int32 Y, TArray<FLinearColor>& Scratch) -> const FLinearColor* { return Level.GetData() + int64(Y) * LevelSize.X; };
+			if (MipIndex == 1)
+			{
+				Downsample(LevelSize, MipSize, DecodeTopRow, NextLevel.GetData());
+			}
+			else
+			{
+				Downsample(LevelSize, MipSize, GetLevelRow, NextLevel.GetData());
+			}
+			Swap(Level, NextLevel);
+			LevelSize = MipSize;
+
+			float AlphaScale = 1.0f;
+			if (bPreserveCoverage)
+			{
+				float MinScale = 0.0f;
+				float MaxScale = MaxCoverageScale;
+				for (int32 Step = 0; Step < CoverageSearchSteps; Step++)
+				{
+					AlphaScale = (MinScale + MaxScale) * 0.5f;
+					const float Coverage = ComputeCoverage(LevelSize, GetLevelRow, Settings.AlphaCoverageThreshold, AlphaScale);
+					(Coverage < TargetCoverage ? MinScale : MaxScale) = AlphaScale;
+				}
+			}
+
+			if (uint8* MipData = Source.LockMip(MipIndex))
+			{
+				ParallelFor(FMath::DivideAndRoundUp(LevelSize.Y, RowsPerTask), [&](int32 TaskIndex)
+				{
+					const int32 LastRow = FMath::Min((TaskIndex + 1) * RowsPerTask, LevelSize.Y);
+					for (int32 Y = TaskIndex * RowsPerTask; Y < LastRow; Y++)
+					{
+						for (int32 X = 0; X < LevelSize.X; X++)
+						{
+							FLinearColor Color = Level[int64(Y) * LevelSize.X + X];
+							if (bPreserveCoverage)
+							{
+								Color.A = FMath::Clamp(Color.A * AlphaScale, 0.0f, 1.0f);
+							}
+							EncodePixel(Format, bGamma, Color, MipData + (int64(Y) * LevelSize.X + X) * PixelBytes);
+						}
+					}
+				});
+			}
+			Source.UnlockMip(MipIndex);
+		}
+		Source.UnlockMip(0);
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture.h"
+#include "Renderer/TextureBakerRenderTypes.h"
+
+/**
+ * CPU generation of source mip chains. Mips are box filtered in linear space from the previous level kept in float,
+ * 8 bit images of sRGB textures are decoded through the sRGB curve first. Odd dimensions use a 3 tap filter, so every
+ * source pixel contributes to the next level. Rows are filtered and encoded in parallel.
+ */
+namespace TextureBakerMips
+{
+	// Full chain down to 1x1, each level rounded down the same way FTextureSource sizes its mips
+	int32 GetNumMips(const FIntPoint& Size);
+
+	// Fills mips 1..N-1 of Source from its mip 0. Source has to be initialized with the whole chain
+	void GenerateMipChain(FTextureSource& Source, bool bSRGB, const FTextureBakerSourceMipSettings& Settings);
+}
@@ -0,0 +1,312 @@
+#include "Renderer/TextureBakerReadback.h"
+#include "TextureBaker.h"
+#include "RHIGPUReadback.h"
+#include "RenderingThread.h"
+#include "HAL/IConsoleManager.h"
+#include "TextureBakerEncodePass.h"
+
+static TAutoConsoleVariable<int32> CVarTextureBakerReadbackArenaMaxMB(
+	TEXT("TextureBaker.Readback.ArenaMaxMB"),
+	1024,
+	TEXT("Host memory in MB the readback arena may hold, including buffers in use. Free buffers above it are released. 0 - don't keep free buffers"),
+	ECVF_Default);
+
+FTextureBakerReadbackArena::~FTextureBakerReadbackArena()
+{
+	checkf(BuffersInUse.Num() == 0, TEXT("Readback arena destroyed with %d buffers in use"), BuffersInUse.Num());
+	Trim();
+}
+
+int32 FTextureBakerReadbackArena::GetSizeClass(uint64 Size)
+{
+	// Smallest class is 64KB, smaller readbacks don't churn the allocator
+	return FMath::Max<int32>(FMath::CeilLogTwo64(Size), 16);
+}
+
+void* FTextureBakerReadbackArena::Acquire(uint64 Size)
+{
+	const int32 SizeClass = GetSizeClass(Size);
+	check(SizeClass < NumSizeClasses);
+
+	void* Buffer = nullptr;
+	if (FreeBuffers[SizeClass].Num())
+	{
+		Buffer = FreeBuffers[SizeClass].Pop(false);
+		NumReuses++;
+	}
+	else
+	{
+		// Make room for the new buffer by dropping retained buffers of other classes first
+		const uint64 MaxBytes = uint64(FMath::Max(CVarTextureBakerReadbackArenaMaxMB.GetValueOnGameThread(), 0)) * 1024 * 1024;
+		if (AllocatedBytes + GetClassSize(SizeClass) > MaxBytes)
+		{
+			FreeRetainedBuffers(AllocatedBytes + GetClassSize(SizeClass) - MaxBytes);
+		}
+		Buffer = FMemory::Malloc(GetClassSize(SizeClass));
+		AllocatedBytes += GetClassSize(SizeClass);
+		PeakBytes = FMath::Max(PeakBytes, AllocatedBytes);
+		NumAllocations++;
+	}
+	BuffersInUse.Add(Buffer, SizeClass);
+	return Buffer;
+}
+
+void FTextureBakerReadbackArena::Release(void* Buffer)
+{
+	int32 SizeClass = INDEX_NONE;
+	if (Buffer && BuffersInUse.RemoveAndCopyValue(Buffer, SizeClass))
+	{
+		const uint64 MaxBytes = uint64(FMath::Max(CVarTextureBakerReadbackArenaMaxMB.GetValueOnGameThread(), 0)) * 1024 * 1024;
+		if (AllocatedBytes > MaxBytes)
+		{
+			FMemory::Free(Buffer);
+			AllocatedBytes -= GetClassSize(SizeClass);
+		}
+		else
+		{
+			FreeBuffers[SizeClass].Add(Buffer);
+		}
+	}
+}
+
+void FTextureBakerReadbackArena::Trim()
+{
+	FreeRetainedBuffers(AllocatedBytes);
+}
+
+void FTextureBakerReadbackArena::FreeRetainedBuffers(uint64 BytesToFree)
+{
+	uint64 FreedBytes = 0;
+	for (int32 SizeClass = NumSizeClasses - 1; SizeClass >= 0 && FreedBytes < BytesToFree; SizeClass--)
+	{
+		while (FreeBuffers[SizeClass].Num() && FreedBytes < BytesToFree)
+		{
+			FMemory::Free(FreeBuffers[SizeClass].Pop(false));
+			FreedBytes += GetClassSize(SizeClass);
+		}
+	}
+	AllocatedBytes -= FreedBytes;
+}
+
+FTextureBakerStagingReadbackRef FTextureBakerReadbackPool::AcquireTextureReadback(const FIntPoint& Size, EPixelFormat Format)
+{
+	FScopeLock Lock(&PoolLock);
+	NumInFlight++;
+	for (int32 Index = FreeTextureReadbacks.Num() - 1; Index >= 0; Index--)
+	{
+		if (FreeTextureReadbacks[Index].Size == Size && FreeTextureReadbacks[Index].Format == Format)
+		{
+			FTextureBakerStagingReadbackRef Readback = FreeTextureReadbacks[Index].Readback;
+			FreeTextureReadbacks.RemoveAtSwap(Index, 1, false);
+			return Readback;
+		}
+	}
+	return MakeShared<FRHIGPUTextureReadback, ESPMode::ThreadSafe>(TEXT("TextureBakerReadback"));
+}
+
+void FTextureBakerReadbackPool::ReleaseTextureReadback(FTextureBakerStagingReadbackRef Readback, const FIntPoint& Size, EPixelFormat Format)
+{
+	FScopeLock Lock(&PoolLock);
+	NumInFlight--;
+	FreeTextureReadbacks.Add({ Size, Format, Readback });
+}
+
+FTextureBakerStagingReadbackRef FTextureBakerReadbackPool::AcquireBufferReadback()
+{
+	FScopeLock Lock(&PoolLock);
+	NumInFlight++;
+	if (FreeBufferReadbacks.Num())
+	{
+		return FreeBufferReadbacks.Pop();
+	}
+	return MakeShared<FRHIGPUBufferReadback, ESPMode::ThreadSafe>(TEXT("TextureBakerEncodedReadback"));
+}
+
+void FTextureBakerReadbackPool::ReleaseBufferReadback(FTextureBakerStagingReadbackRef Readback)
+{
+	FScopeLock Lock(&PoolLock);
+	NumInFlight--;
+	FreeBufferReadbacks.Add(Readback);
+}
+
+FTextureBakerPendingReadback::FTextureBakerPendingReadback(TSharedRef<FTextureBakerReadbackPool, ESPMode::ThreadSafe> Pool, UTextureRenderTarget2D* SourceRT) :
+	OwnerPool(Pool), bCopyEnqueued(MakeShared<bool, ESPMode::ThreadSafe>(false)), SurfaceFormat(PF_Unknown), Size(0, 0), EncodedFormat(ETextureSourceFormat::TSF_Invalid), EncodedBytes(0)
+{
+	FTextureRenderTargetResource* RenderTargetResource = SourceRT ? SourceRT->GameThread_GetRenderTargetResource() : nullptr;
+	if (RenderTargetResource)
+	{
+		SurfaceFormat = SourceRT->GetFormat();
+		Size = FIntPoint(SourceRT->SizeX, SourceRT->SizeY);
+		StagingReadback = OwnerPool->AcquireTextureReadback(Size, SurfaceFormat);
+
+		TSharedPtr<FRHIGPUMemoryReadback, ESPMode::ThreadSafe> LocalReadback = StagingReadback;
+		ENQUEUE_RENDER_COMMAND(TextureBakerEnqueueReadback)(
+			[LocalReadback, RenderTargetResource](FRHICommandListImmediate& RHICmdList)
+			{
+				FRHITexture* SourceTexture = RenderTargetResource->TextureRHI;
+				RHICmdList.Transition(FRHITransitionInfo(SourceTexture, ERHIAccess::Unknown, ERHIAccess::CopySrc));
+				LocalReadback->EnqueueCopy(RHICmdList, SourceTexture);
+				RHICmdList.Transition(FRHITransitionInfo(SourceTexture, ERHIAccess::CopySrc, ERHIAccess::SRVMask));
+			});
+	}
+}
+
+FTextureBakerPendingReadback::FTextureBakerPendingReadback(TSharedRef<FTextureBakerReadbackPool, ESPMode::ThreadSafe> Pool, UTextureRenderTarget2D* SourceRT, const FTextureBakerEncodeSettings& EncodeSettings) :
+	OwnerPool(Pool), bCopyEnqueued(MakeShared<bool, ESPMode::ThreadSafe>(false)), SurfaceFormat(PF_Unknown), Size(0, 0), EncodedFormat(ETextureSourceFormat::TSF_Invalid), EncodedBytes(0)
+{
+	FTextureRenderTargetResource* RenderTargetResource = SourceRT ? SourceRT->GameThread_GetRenderTargetResource() : nullptr;
+	if (RenderTargetResource && FTextureBakerEncodePass::SupportsImageFormat(EncodeSettings.ImageFormat))
+	{
+		SurfaceFormat = SourceRT->GetFormat();
+		Size = FIntPoint(SourceRT->SizeX, SourceRT->SizeY);
+		EncodedFormat = EncodeSettings.ImageFormat;
+		EncodedBytes = FTextureBakerEncodePass::GetEncodedBufferSize(EncodedFormat, Size);
+		StagingReadback = OwnerPool->AcquireBufferReadback();
+		if (EncodeSettings.bComputeRange)
+		{
+			RangeReadback = OwnerPool->AcquireBufferReadback();
+		}
+
+		FTextureBakerEncodeSettings LocalSettings = EncodeSettings;
+		LocalSettings.Size = Size;
+		TSharedPtr<FRHIGPUMemoryReadback, ESPMode::ThreadSafe> LocalReadback = StagingReadback;
+		TSharedPtr<FRHIGPUMemoryReadback, ESPMode::ThreadSafe> LocalRangeReadback = RangeReadback;
+		TSharedRef<bool, ESPMode::ThreadSafe> LocalCopyEnqueued = bCopyEnqueued;
+		const uint32 LocalEncodedBytes = EncodedBytes;
+		ENQUEUE_RENDER_COMMAND(TextureBakerEncodeReadback)(
+			[LocalReadback, LocalRangeReadback, LocalCopyEnqueued, RenderTargetResource, LocalSettings, LocalEncodedBytes](FRHICommandListImmediate& RHICmdList)
+			{
+				// Buffers are released with this command, RHI keeps them alive until the copies are done
+				FRWBuffer EncodedImage;
+				FRWBuffer ImageRange;
+				if (FTextureBakerEncodePass::AddPass(RHICmdList, RenderTargetResource->TextureRHI, EncodedImage, ImageRange, LocalSettings))
+				{
+					LocalReadback->EnqueueCopy(RHICmdList, EncodedImage.Buffer, LocalEncodedBytes);
+					if (LocalRangeReadback.IsValid())
+					{
+						LocalRangeReadback->EnqueueCopy(RHICmdList, ImageRange.Buffer, FTextureBakerEncodePass::RangeBufferSize);
+					}
+					*LocalCopyEnqueued = true;
+				}
+			});
+	}
+}
+
+FTextureBakerPendingReadback::~FTextureBakerPendingReadback()
+{
+	ReleaseStaging();
+}
+
+bool FTextureBakerPendingReadback::IsReady() const
+{
+	return StagingReadback.IsValid() && StagingReadback->IsReady();
+}
+
+bool FTextureBakerPendingReadback::Resolve(const FTextureBakerSurfaceReadback& Handler, void* DestBuffer)
+{
+	if (!StagingReadback.IsValid() || !DestBuffer || EncodedFormat != ETextureSourceFormat::TSF_Invalid || !Handler.SupportsStagingReadback(SurfaceFormat))
+	{
+		return false;
+	}
+
+	bool bResolved = false;
+	bool* bResolvedPtr = &bResolved;
+	TSharedPtr<FRHIGPUTextureReadback, ESPMode::ThreadSafe> LocalReadback = StaticCastSharedPtr<FRHIGPUTextureReadback>(StagingReadback);
+	const FTextureBakerSurfaceReadback* LocalHandler = &Handler;
+	const EPixelFormat LocalFormat = SurfaceFormat;
+	const FIntPoint LocalSize = Size;
+	ENQUEUE_RENDER_COMMAND(TextureBakerResolveReadback)(
+		[LocalReadback, LocalHandler, LocalFormat, LocalSize, DestBuffer, bResolvedPtr](FRHICommandListImmediate& RHICmdList)
+		{
+			// Mapping a staging texture waits for the copy only, not for the work submitted after it
+			void* SurfaceData = nullptr;
+			int32 RowPitchInPixels = 0;
+			LocalReadback->LockTexture(RHICmdList, SurfaceData, RowPitchInPixels);
+			if (SurfaceData)
+			{
+				LocalHandler->ReadbackStagingSurface(SurfaceData, RowPitchInPixels, LocalFormat, LocalSize, DestBuffer);
+				*bResolvedPtr = true;
+			}
+			LocalReadback->Unlock();
+		});
+
+	// Handler, destination buffer and result flag live on this stack frame, so wait for the command to be executed
+	FRenderCommandFence ResolveFence;
+	ResolveFence.BeginFence();
+	ResolveFence.Wait();
+
+	ReleaseStaging();
+	return bResolved;
+}
+
+bool FTextureBakerPendingReadback::ResolveEncoded(void* DestBuffer, uint64 DestBufferSize)
+{
+	const uint64 ImageBytes = uint64(FTextureSource::GetBytesPerPixel(EncodedFormat)) * Size.X * Size.Y;
+	if (!StagingReadback.IsValid() || !DestBuffer || EncodedFormat == ETextureSourceFormat::TSF_Invalid || DestBufferSize < ImageBytes)
+	{
+		return false;
+	}
+
+	bool bResolved = false;
+	bool* bResolvedPtr = &bResolved;
+	FTextureBakerImageStats* StatsPtr = &ImageStats;
+	TSharedPtr<FRHIGPUMemoryReadback, ESPMode::ThreadSafe> LocalReadback = StagingReadback;
+	TSharedPtr<FRHIGPUMemoryReadback, ESPMode::ThreadSafe> LocalRangeReadback = RangeReadback;
+	TSharedRef<bool, ESPMode::ThreadSafe> LocalCopyEnqueued = bCopyEnqueued;
+	const uint32 LocalEncodedBytes = EncodedBytes;
+	ENQUEUE_RENDER_COMMAND(TextureBakerResolveEncodedReadback)(
+		[LocalReadback, LocalRangeReadback, LocalCopyEnqueued, LocalEncodedBytes, ImageBytes, DestBuffer, bResolvedPtr, StatsPtr](FRHICommandListImmediate& RHICmdList)
+		{
+			// Encode pass was rejected, the pooled buffers hold nothing or an earlier image
+			if (!*LocalCopyEnqueued)
+			{
+				return;
+			}
+
+			// Encoded buffer is padded to whole words, only the image part is copied
+			if (const void* EncodedData = LocalReadback->Lock(LocalEncodedBytes))
+			{
+				FMemory::Memcpy(DestBuffer, EncodedData, ImageBytes);
+				*bResolvedPtr = true;
+			}
+			LocalReadback->Unlock();
+
+			if (LocalRangeReadback.IsValid())
+			{
+				if (const uint32* RangeWords = static_cast<const uint32*>(LocalRangeReadback->Lock(FTextureBakerEncodePass::RangeBufferSize)))
+				{
+					FTextureBakerEncodePass::DecodeRange(RangeWords, StatsPtr->Min, StatsPtr->Max);
+					StatsPtr->bValid = true;
+				}
+				LocalRangeReadback->Unlock();
+			}
+		});
+
+	FRenderCommandFence ResolveFence;
+	ResolveFence.BeginFence();
+	ResolveFence.Wait();
+
+	ReleaseStaging();
+	return bResolved;
+}
+
+void FTextureBakerPendingReadback::ReleaseStaging()
+{
+	if (StagingReadback.IsValid())
+	{
+		if (EncodedFormat != ETextureSourceFormat::TSF_Invalid)
+		{
+			OwnerPool->ReleaseBufferReadback(StagingReadback.ToSharedRef());
+		}
+		else
+		{
+			OwnerPool->ReleaseTextureReadback(StagingReadback.ToSharedRef(), Size, SurfaceFormat);
+		}
+		StagingReadback.Reset();
+	}
+	if (RangeReadback.IsValid())
+	{
+		OwnerPool->ReleaseBufferReadback(RangeReadback.ToSharedRef());
+		RangeReadback.Reset();
+	}
+}
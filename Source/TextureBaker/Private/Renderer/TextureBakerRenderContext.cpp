@@ -1,9 +1,112 @@
 #include "Renderer/TextureBakerRenderContext.h"
 #include "Engine/Canvas.h"
 #include "TextureBakerScenario.h"
+#include "HAL/IConsoleManager.h"
+#include "TextureBaker.h"
+#include "TextureBakerEncodePass.h"
+#include "RenderUtils.h"
+
+static TAutoConsoleVariable<int32> CVarTextureBakerAsyncReadback(
+	TEXT("TextureBaker.Readback.Async"),
+	1,
+	TEXT("Copy baked outputs into staging textures and read them back without stalling the GPU. 0 - use blocking ReadPixels"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTextureBakerReadbacksInFlight(
+	TEXT("TextureBaker.Readback.MaxInFlight"),
+	2,
+	TEXT("Number of baked outputs kept in flight before the oldest one is read back and saved. 1 - save each output right after it is rendered"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTextureBakerGPUEncode(
+	TEXT("TextureBaker.Readback.GPUEncode"),
+	1,
+	TEXT("Encode float outputs to the final image format on the GPU before readback. 0 - transcode readback data on the CPU"),
+	ECVF_Default);
+
+// Float surfaces which need transcoding or range processing are encoded by the GPU pass. 8 bit surfaces are either copied
+// as is or decoded through the sRGB table on the CPU, which sampling them on the GPU wouldn't reproduce. Saturate rescales each
+// channel by its range the way the engine readback does, and sRGB images need pow, neither of them is bit exact on the GPU
+static bool GetGPUEncodeSettings(UTextureRenderTarget2D* SourceRT, ETextureSourceFormat ImageFormat, ETBImageNormalization Normalization, FTextureBakerEncodeSettings& OutSettings)
+{
+	const ETextureRenderTargetFormat SurfaceFormat = SourceRT->RenderTargetFormat;
+	if (CVarTextureBakerGPUEncode.GetValueOnGameThread() == 0 || !FTextureBakerEncodePass::SupportsImageFormat(ImageFormat))
+	{
+		return false;
+	}
+	if (SurfaceFormat != ETextureRenderTargetFormat::RTF_R16f && SurfaceFormat != ETextureRenderTargetFormat::RTF_RGBA16f && SurfaceFormat != ETextureRenderTargetFormat::RTF_RGBA32f)
+	{
+		return false;
+	}
+	if (Normalization == ETBImageNormalization::Saturate || (ImageFormat == ETextureSourceFormat::TSF_BGRA8 && SourceRT->IsSRGB()))
+	{
+		return false;
+	}
+
+	// Normalize keeps raw values and Auto rescales them, both get the range reduced on the GPU instead of scanned on the CPU
+	OutSettings.ImageFormat = ImageFormat;
+	OutSettings.Size = FIntPoint(SourceRT->SizeX, SourceRT->SizeY);
+	OutSettings.bSingleChannelSource = (SurfaceFormat == ETextureRenderTargetFormat::RTF_R16f);
+	OutSettings.bComputeRange = true;
+	OutSettings.bNormalizeRange = (Normalization == ETBImageNormalization::Auto);
+	return true;
+}
+
+FTextureBakerTiledImage::FTextureBakerTiledImage(const FIntPoint& InSize, ETextureSourceFormat InFormat, bool bAllocateData) : Size(InSize), Format(InFormat), bSRGB(false), ExternalData(nullptr)
+{
+	if (bAllocateData)
+	{
+		Data.SetNumUninitialized(uint64(FTextureSource::GetBytesPerPixel(Format)) * Size.X * Size.Y);
+	}
+}
+
+void FTextureBakerTiledImage::WriteTile(const FIntRect& TileRect, const void* TileData)
+{
+	const uint64 PixelBytes = FTextureSource::GetBytesPerPixel(Format);
+	const uint64 TileRowBytes = PixelBytes * TileRect.Width();
+	for (int32 Row = 0; Row < TileRect.Height(); Row++)
+	{
+		uint8* DestRow = GetData() + (uint64(TileRect.Min.Y + Row) * Size.X + TileRect.Min.X) * PixelBytes;
+		FMemory::Memcpy(DestRow, FTextureBakerMath::OffsetPointer(TileData, Row * TileRowBytes), TileRowBytes);
+	}
+}
+
+void FTextureBakerTiledImage::FillTile(const FIntRect& TileRect, const void* PixelData)
+{
+	const uint64 PixelBytes = FTextureSource::GetBytesPerPixel(Format);
+	const uint64 TileRowBytes = PixelBytes * TileRect.Width();
+	uint8* FirstRow = GetData() + (uint64(TileRect.Min.Y) * Size.X + TileRect.Min.X) * PixelBytes;
+	for (int32 Column = 0; Column < TileRect.Width(); Column++)
+	{
+		FMemory::Memcpy(FirstRow + Column * PixelBytes, PixelData, PixelBytes);
+	}
+	for (int32 Row = 1; Row < TileRect.Height(); Row++)
+	{
+		FMemory::Memcpy(FirstRow + uint64(Row) * Size.X * PixelBytes, FirstRow, TileRowBytes);
+	}
+}
+
+void FTextureBakerTiledImage::AddTileStats(const FTextureBakerImageStats& TileStats)
+{
+	if (!TileStats.bValid)
+	{
+		return;
+	}
+	if (!Stats.bValid)
+	{
+		Stats = TileStats;
+		return;
+	}
+	for (int32 Channel = 0; Channel < 4; Channel++)
+	{
+		Stats.Min.Component(Channel) = FMath::Min(Stats.Min.Component(Channel), TileStats.Min.Component(Channel));
+		Stats.Max.Component(Channel) = FMath::Max(Stats.Max.Component(Channel), TileStats.Max.Component(Channel));
+	}
+}
 
 FTextureBakerRenderContext::FTextureBakerRenderContext(UTextureBakerScenario* InitializedTemplate, const FString& OutputPath, bool bIsPreview) :
-	bIsPreviewContext(bIsPreview), OwnedScenario(nullptr), CurrentRenderScope(MakeShared<FTextureBakerRenderScope>(this)), OutputDirectoryPath(OutputPath)
+	bIsPreviewContext(bIsPreview), OwnedScenario(nullptr), CurrentRenderScope(MakeShared<FTextureBakerRenderScope>(this)), OutputDirectoryPath(OutputPath),
+	ResourceCache(FTextureBakerModule::GetChecked().GetResourceCache()), bUseDerivedArtCache(FTextureBakerDerivedArtCache::IsEnabled()), ReadbackPool(MakeShared<FTextureBakerReadbackPool, ESPMode::ThreadSafe>())
 {
 	OwnedScenario = DuplicateObject<UTextureBakerScenario>(InitializedTemplate, GetTransientPackage(), NAME_None);
 
@@ -45,21 +148,37 @@ FTextureBakerRenderResult FTextureBakerRenderContext::BakeOutput(FName OutputToB
 	if (OwnedScenario && OutputInfos.Contains(OutputToBake))
 	{
 		const FTextureBakerOutputWriteout& OutputInfo = OutputInfos.FindChecked(OutputToBake);
-		if (OutputInfo.IsValid())
+		if (OutputInfo.IsValid() && OutputInfo.IsTiled())
+		{
+			// Image data is provided by the caller, tiles are written straight to where the output goes
+			TSharedPtr<FTextureBakerTiledImage> Image = MakeShared<FTextureBakerTiledImage>(OutputInfo.OutputDimensions, OutputInfo.OutputImageFormat, false);
+			const FTextureBakerOutputWriteout TiledOutputInfo = OutputInfo;
+			return FTextureBakerRenderResult(OutputInfo, OutputInfo.OutputAssetPath, Image, [this, TiledOutputInfo](FTextureBakerTiledImage& InImage)
+			{
+				return BakeTiledOutput(TiledOutputInfo, InImage);
+			});
+		}
+		else if (OutputInfo.IsValid())
 		{
 			if (OutputInfo.OnRenderOutputTarget.IsBoundToObject(OwnedScenario))
 			{
+				FTextureBakerOutputWriteout RenderInfo(OutputInfo);
+				RenderInfo.SetTile(FIntRect(FIntPoint::ZeroValue, OutputInfo.OutputDimensions));
 				UCanvas* DrawingCanvas = CurrentRenderScope->CreateTemporaryDrawRT(OutputInfo.OutputDimensions, OutputInfo.GetRenderTargetFormat(), OutputInfo.DefaultColor, false);
-				if (OutputInfo.OnRenderOutputTarget.Execute(OutputInfo, bIsPreviewContext, DrawingCanvas))
+				if (OutputInfo.OnRenderOutputTarget.Execute(RenderInfo, bIsPreviewContext, DrawingCanvas))
 				{
-					return FTextureBakerRenderResult(OutputInfo, OutputInfo.OutputAssetPath, CurrentRenderScope->ResolveTemporaryDrawRT_AsRenderTarget(DrawingCanvas));
+					UTextureRenderTarget2D* ResolvedRT = CurrentRenderScope->ResolveTemporaryDrawRT_AsRenderTarget(DrawingCanvas);
+					CurrentRenderScope->ReleaseTemporaryResource(DrawingCanvas);
+					return FTextureBakerRenderResult(OutputInfo, OutputInfo.OutputAssetPath, ResolvedRT, BeginReadback(ResolvedRT, OutputInfo.OutputImageFormat, OutputInfo.Normalization));
 				}
 			}
 			else
 			{
 				UCanvas* DrawingCanvas = CurrentRenderScope->CreateTemporaryDrawRT(OutputInfo.OutputDimensions, OutputInfo.GetRenderTargetFormat(), OutputInfo.DefaultColor, false);
 				DrawingCanvas->DrawText(GEngine->GetSmallFont(), FText::FromString(TEXT("Missing handler!")), 0.0f, 0.0f);
-				return FTextureBakerRenderResult(OutputInfo, OutputInfo.OutputAssetPath, CurrentRenderScope->ResolveTemporaryDrawRT_AsRenderTarget(DrawingCanvas));
+				UTextureRenderTarget2D* ResolvedRT = CurrentRenderScope->ResolveTemporaryDrawRT_AsRenderTarget(DrawingCanvas);
+				CurrentRenderScope->ReleaseTemporaryResource(DrawingCanvas);
+				return FTextureBakerRenderResult(OutputInfo, OutputInfo.OutputAssetPath, ResolvedRT, BeginReadback(ResolvedRT, OutputInfo.OutputImageFormat, OutputInfo.Normalization));
 			}
 			return FTextureBakerRenderResult(OutputInfo, OutputInfo.OutputAssetPath);
 		}
@@ -67,6 +186,114 @@ FTextureBakerRenderResult FTextureBakerRenderContext::BakeOutput(FName OutputToB
 	return FTextureBakerRenderResult();
 }
 
+bool FTextureBakerRenderContext::BakeTiledOutput(const FTextureBakerOutputWriteout& OutputInfo, FTextureBakerTiledImage& Image)
+{
+	struct FTileInFlight
+	{
+		FIntRect Rect;
+		UTextureRenderTarget2D* RenderTarget;
+		TSharedPtr<FTextureBakerPendingReadback> Readback;
+		bool bEmpty;
+	};
+
+	const FIntPoint OutputSize = OutputInfo.OutputDimensions;
+	const int32 TileSize = FMath::Min(OutputInfo.TileSize, FTextureBakerOutputInfo::MaxOutputSize);
+	const ETextureSourceFormat ImageFormat = OutputInfo.OutputImageFormat;
+	const ETextureRenderTargetFormat RenderTargetFormat = OutputInfo.GetRenderTargetFormat();
+	const uint64 ImagePixelBytes = FTextureSource::GetBytesPerPixel(ImageFormat);
+	const bool bHandlerIsBound = OutputInfo.OnRenderOutputTarget.IsBoundToObject(OwnedScenario);
+	const int32 MaxTilesInFlight = GetMaxReadbacksInFlight();
+
+	check(Image.GetData() && Image.Size == OutputSize && Image.Format == ImageFormat);
+	TArray<FTileInFlight> TilesInFlight;
+	TArray<uint8> DefaultPixel;
+
+	// Tile render targets go back to the pool once read, so the next tiles reuse them
+	auto FinishTile = [&](const FTileInFlight& Tile)
+	{
+		void* TileData = ReadbackArena.Acquire(ImagePixelBytes * Tile.Rect.Area());
+		FTextureBakerModule::GetChecked().ReadRenderTargetImage(ImageFormat, Tile.RenderTarget, OutputInfo.Normalization, Tile.Readback.Get(), TileData, &ReadbackArena);
+		if (Tile.Readback.IsValid())
+		{
+			Image.AddTileStats(Tile.Readback->GetImageStats());
+		}
+		Image.WriteTile(Tile.Rect, TileData);
+		if (!DefaultPixel.Num() && Tile.bEmpty)
+		{
+			DefaultPixel.Append(static_cast<const uint8*>(TileData), int32(ImagePixelBytes));
+		}
+		ReadbackArena.Release(TileData);
+		CurrentRenderScope->ReleaseTemporaryResource(Tile.RenderTarget);
+	};
+
+	bool bAllTilesRendered = true;
+	for (int32 TileY = 0; TileY < OutputSize.Y && bAllTilesRendered; TileY += TileSize)
+	{
+		for (int32 TileX = 0; TileX < OutputSize.X && bAllTilesRendered; TileX += TileSize)
+		{
+			const FIntRect TileRect(TileX, TileY, FMath::Min(TileX + TileSize, OutputSize.X), FMath::Min(TileY + TileSize, OutputSize.Y));
+			UCanvas* DrawingCanvas = CurrentRenderScope->CreateTemporaryDrawTile(OutputSize, TileRect, RenderTargetFormat, OutputInfo.DefaultColor);
+			if (!DrawingCanvas)
+			{
+				bAllTilesRendered = false;
+				break;
+			}
+
+			if (bHandlerIsBound)
+			{
+				FTextureBakerOutputWriteout TileInfo(OutputInfo);
+				TileInfo.SetTile(TileRect);
+				bAllTilesRendered = OutputInfo.OnRenderOutputTarget.Execute(TileInfo, bIsPreviewContext, DrawingCanvas);
+			}
+			else
+			{
+				DrawingCanvas->DrawText(GEngine->GetSmallFont(), FText::FromString(TEXT("Missing handler!")), 0.0f, 0.0f);
+			}
+
+			// Nothing was drawn on the tile, so it holds the clear color only
+			const bool bEmptyTile = !CurrentRenderScope->HasPendingDraws(DrawingCanvas);
+			UTextureRenderTarget2D* TileRT = CurrentRenderScope->ResolveTemporaryDrawRT_AsRenderTarget(DrawingCanvas);
+			CurrentRenderScope->ReleaseTemporaryResource(DrawingCanvas);
+			if (!bAllTilesRendered || !TileRT)
+			{
+				CurrentRenderScope->ReleaseTemporaryResource(TileRT);
+				bAllTilesRendered = false;
+				break;
+			}
+
+			Image.bSRGB = TileRT->IsSRGB();
+			if (bEmptyTile && DefaultPixel.Num())
+			{
+				Image.FillTile(TileRect, DefaultPixel.GetData());
+				CurrentRenderScope->ReleaseTemporaryResource(TileRT);
+				continue;
+			}
+
+			FTileInFlight Tile = { TileRect, TileRT, BeginReadback(TileRT, ImageFormat, OutputInfo.Normalization), bEmptyTile };
+			if (bEmptyTile)
+			{
+				// First empty tile is read back to get the clear color exactly as the surface stores it
+				FinishTile(Tile);
+				continue;
+			}
+
+			TilesInFlight.Add(Tile);
+			while (TilesInFlight.Num() >= MaxTilesInFlight)
+			{
+				FinishTile(TilesInFlight[0]);
+				TilesInFlight.RemoveAt(0);
+			}
+		}
+	}
+
+	for (const FTileInFlight& Tile : TilesInFlight)
+	{
+		FinishTile(Tile);
+	}
+
+	return bAllTilesRendered;
+}
+
 void FTextureBakerRenderContext::AddReferencedObjects(FReferenceCollector& Collector)
 {
 	Collector.AddReferencedObject(OwnedScenario);
@@ -86,20 +313,6 @@ void FTextureBakerRenderContext::AddReferencedObjects(FReferenceCollector& Colle
 		}
 	}
 
-	for (TPair<FTextureBakerDerivedArtKey, UTexture2D*>& DerivedArtEntry : DerivedArtPool)
-	{
-		Collector.AddReferencedObject(DerivedArtEntry.Value);
-	}
-	Collector.AddReferencedObjects(RenderTargetPool);
-	Collector.AddReferencedObjects(CanvasPool);
-
-	for (auto It = DerivedArtPool.CreateIterator(); It; ++It)
-	{
-		if (!IsValid(It.Value()))
-		{
-			It.RemoveCurrent();
-		}
-	}
 }
 
 TSharedRef<FTextureBakerRenderScope> FTextureBakerRenderContext::EnterRenderScope()
@@ -121,37 +334,56 @@ bool FTextureBakerRenderContext::ExitRenderScope()
 
 UTexture2D* FTextureBakerRenderContext::GetOrCreateDerivedArt(UTexture2D* Source, const FTextureBakerResourceRequirements& Options)
 {
+	// Derived art passed back in has no source of its own, it's keyed by the texture it came from
+	Source = ResourceCache->FindDerivedArtOriginal(Source);
 	if (!Source || !Source->Source.IsValid())
 	{
 		return nullptr;
 	}
 
+	// Known sources are found without touching their bulk data
 	FTextureSource& SourceArt = Source->Source;
-	FTextureBakerDerivedArtKey SourceArtKey(Options, SourceArt);
-	SIZE_T ReferenceMipSize = SourceArt.CalcMipSize(0);
-	if (uint8* Reference = SourceArt.LockMip(0))
+	FTextureBakerDerivedArtCache& DerivedArtCache = ResourceCache->GetDerivedArtCache();
+	FGuid ContentHash;
+	const bool bKnownSource = DerivedArtCache.FindContentHash(SourceArt.GetId(), ContentHash);
+	if (bKnownSource)
 	{
-		for (auto It = DerivedArtPool.CreateKeyIterator(SourceArtKey); It; ++It)
+		if (UTexture2D* ExistingTexture = ResourceCache->FindDerivedArt(FTextureBakerDerivedArtKey(Options, SourceArt, ContentHash)))
 		{
-			UTexture2D* ExistingTexture = It.Value();
-			if (!ExistingTexture->Source.IsValid())
-			{
-				It.RemoveCurrent();
-				continue;
-			}
-			SIZE_T ExistingMipSize = ExistingTexture->Source.CalcMipSize(0);
-			bool bTextureIsPhysicallyMatching = false;
-			if (uint8* Content = (ExistingMipSize == ReferenceMipSize) ? ExistingTexture->Source.LockMip(0) : nullptr)
+			return ExistingTexture;
+		}
+	}
+
+	// Source art cached on disk is mapped, the source itself is locked only when the cache doesn't have it
+	FTextureBakerCachedSourceArt CachedSourceArt;
+	const bool bUseCachedSourceArt = bKnownSource && bUseDerivedArtCache && DerivedArtCache.LoadSourceArt(ContentHash, CachedSourceArt) && CachedSourceArt.Matches(SourceArt);
+	const uint8* Reference = bUseCachedSourceArt ? CachedSourceArt.GetData() : SourceArt.LockMip(0);
+	if (Reference)
+	{
+		auto UnlockSourceArt = [&SourceArt, bUseCachedSourceArt]()
+		{
+			if (!bUseCachedSourceArt)
 			{
-				bTextureIsPhysicallyMatching = (FMemory::Memcmp(Reference, Content, ReferenceMipSize) == 0);
-				ExistingTexture->Source.UnlockMip(0);
+				SourceArt.UnlockMip(0);
 			}
-			if (bTextureIsPhysicallyMatching)
+		};
+		if (!bKnownSource)
+		{
+			ContentHash = FTextureBakerDerivedArtCache::CalcContentHash(SourceArt, Reference);
+			DerivedArtCache.AddContentHash(SourceArt.GetId(), ContentHash);
+
+			// Another texture may have the same content
+			if (UTexture2D* ExistingTexture = ResourceCache->FindDerivedArt(FTextureBakerDerivedArtKey(Options, SourceArt, ContentHash)))
 			{
-				SourceArt.UnlockMip(0);
+				UnlockSourceArt();
 				return ExistingTexture;
 			}
 		}
+		if (bUseDerivedArtCache && !bUseCachedSourceArt)
+		{
+			DerivedArtCache.StoreSourceArt(ContentHash, SourceArt, Reference);
+		}
+		const FTextureBakerDerivedArtKey SourceArtKey(Options, SourceArt, ContentHash);
 
 		// Creates new derived art object
 		FIntPoint NewTextureSize = Options.bUseImportedResolution ? Source->GetImportedSize() : FIntPoint(Source->GetSizeX(), Source->GetSizeY());
@@ -166,82 +398,127 @@ UTexture2D* FTextureBakerRenderContext::GetOrCreateDerivedArt(UTexture2D* Source
 			OutTexture->SRGB = Source->SRGB;
 			OutTexture->MaxTextureSize = Options.bUseImportedResolution ? NewTextureSize.GetMax() : Source->MaxTextureSize;
 			OutTexture->Source.Init(SourceArt.GetSizeX(), SourceArt.GetSizeY(), 1, SourceArt.GetNumMips(), SourceArt.GetFormat(), Reference);
-			SourceArt.UnlockMip(0);
+			UnlockSourceArt();
+
+			// Content hash as the source Id keeps the DDC key of the build the same in every session, so built mips come from the DDC
+			OutTexture->Source.SetId(ContentHash, true);
 			
-			OutTexture->UpdateResource();
-			DerivedArtPool.Add(SourceArtKey, OutTexture);
+			// Source copy and the GPU resource are what the pool keeps alive, the source copy only until the texture is built
+			int64 SourceBytes = 0;
+			for (int32 MipIndex = 0; MipIndex < OutTexture->Source.GetNumMips(); MipIndex++)
+			{
+				SourceBytes += OutTexture->Source.CalcMipSize(MipIndex);
+			}
+			const int64 TextureBytes = CalcTextureSize(NewTextureSize.X, NewTextureSize.Y, Source->GetPixelFormat(), FMath::FloorLog2(NewTextureSize.GetMax()) + 1);
+			ResourceCache->AddDerivedArt(SourceArtKey, OutTexture, TextureBytes + SourceBytes, SourceBytes, Source);
+
+			// Deferred builds are waited for by the first consumer, see FTextureBakerRenderScope::WaitForTexture
+			if (FTextureBakerCompressionQueue* BuildQueue = GetTextureBuildQueue())
+			{
+				BuildQueue->Add(OutTexture, false, [SharedResourceCache = ResourceCache](UTexture2D* BuiltTexture) { SharedResourceCache->ReleaseDerivedArtSource(BuiltTexture); });
+			}
+			else
+			{
+				OutTexture->UpdateResource();
+				ResourceCache->ReleaseDerivedArtSource(OutTexture);
+			}
 			return OutTexture;
 		}
-		SourceArt.UnlockMip(0);
+		UnlockSourceArt();
 	}
 
 	return nullptr;
 }
 
-UTextureRenderTarget2D* FTextureBakerRenderContext::GetOrCreateRT(const FIntPoint& InTargetSize, ETextureRenderTargetFormat Format)
+void FTextureBakerRenderContext::GetTransientPeakBytes(int64& OutUnaliasedBytes, int64& OutAliasedBytes) const
 {
-	for (auto It = RenderTargetPool.CreateIterator(); It; ++It)
+	TArray<FTextureBakerTransientLifetime> Lifetimes = FinishedTransientLifetimes;
+	for (TSharedPtr<FTextureBakerRenderScope> Scope = CurrentRenderScope; Scope.IsValid(); Scope = Scope->GetParentScope())
+	{
+		Scope->GetTransientLifetimes(Lifetimes);
+	}
+
+	// Sweep over allocation and release events, releases go first when both happen at the same time
+	auto FindPeak = [&Lifetimes](bool bUntilScopeEnd)
 	{
-		UTextureRenderTarget2D* PoolRenderTarget = *It;
-		if (PoolRenderTarget->SizeX == InTargetSize.X && PoolRenderTarget->SizeY == InTargetSize.Y && PoolRenderTarget->RenderTargetFormat == Format)
+		TArray<TPair<double, int64>> Events;
+		for (const FTextureBakerTransientLifetime& Lifetime : Lifetimes)
 		{
-			It.RemoveCurrent();
-			return PoolRenderTarget;
+			Events.Emplace(Lifetime.FirstUse, Lifetime.Bytes);
+			Events.Emplace(bUntilScopeEnd ? Lifetime.ScopeEnd : Lifetime.LastUse, -Lifetime.Bytes);
 		}
-	}
-	
-	// Not found - create a new one.
-	UTextureRenderTarget2D* RenderTarget = NewObject<UTextureRenderTarget2D>();
-	check(RenderTarget);
-	RenderTarget->RenderTargetFormat = Format;
-	RenderTarget->InitAutoFormat(InTargetSize.X, InTargetSize.Y);
-	return RenderTarget;
+		Events.Sort([](const TPair<double, int64>& A, const TPair<double, int64>& B) { return A.Key < B.Key || (A.Key == B.Key && A.Value < B.Value); });
+		int64 LiveBytes = 0;
+		int64 PeakBytes = 0;
+		for (const TPair<double, int64>& Event : Events)
+		{
+			LiveBytes += Event.Value;
+			PeakBytes = FMath::Max(PeakBytes, LiveBytes);
+		}
+		return PeakBytes;
+	};
+	OutUnaliasedBytes = FindPeak(true);
+	OutAliasedBytes = FindPeak(false);
+}
+
+FTextureBakerCompressionQueue* FTextureBakerRenderContext::GetTextureBuildQueue()
+{
+	return (OwnedScenario && OwnedScenario->bDeferTemporaryTextureBuilds) ? &TextureBuildQueue : nullptr;
+}
+
+UTextureRenderTarget2D* FTextureBakerRenderContext::GetOrCreateRT(const FIntPoint& InTargetSize, ETextureRenderTargetFormat Format, bool bAutoGenerateMips, const FLinearColor& ClearColor)
+{
+	return ResourceCache->AcquireRenderTarget(InTargetSize, Format, bAutoGenerateMips, ClearColor);
 }
 
 UCanvas* FTextureBakerRenderContext::GetOrCreateCanvas()
 {
-	while (CanvasPool.Num())
-	{
-		if (UCanvas* ExistingCanvas = CanvasPool.Pop())
-		{
-			return ExistingCanvas;
-		}
-	}
-	UCanvas* CanvasForRenderingToTarget = NewObject<UCanvas>(GetTransientPackage(), NAME_None);
-	check(CanvasForRenderingToTarget);
-	return CanvasForRenderingToTarget;
+	return ResourceCache->AcquireCanvas();
+}
+
+UTexture2D* FTextureBakerRenderContext::GetDerivedArtOriginal(UTexture2D* Texture)
+{
+	return ResourceCache->FindDerivedArtOriginal(Texture);
 }
 
 bool FTextureBakerRenderContext::ReleaseObject(UObject* Object)
 {
 	if (UTextureRenderTarget2D* RenderTargetObject = Cast<UTextureRenderTarget2D>(Object))
 	{
-		if (!RenderTargetPool.Contains(RenderTargetObject))
-		{
-			RenderTargetPool.Add(RenderTargetObject);
-			return true;
-		}
+		return ResourceCache->ReleaseRenderTarget(RenderTargetObject);
 	}
 	else if (UTexture2D* DerivedArtTexture = Cast<UTexture2D>(Object))
 	{
-		bool bFoundAnything = false;
-		for (auto It = DerivedArtPool.CreateIterator(); It; ++It)
-		{
-			if (It.Value() == DerivedArtTexture)
-			{
-				It.RemoveCurrent();
-				bFoundAnything = true;
-			}
-		}
-		return bFoundAnything;
+		return ResourceCache->RemoveDerivedArt(DerivedArtTexture);
 	}
 	else if (UCanvas* RenderTargetCanvas = Cast<UCanvas>(Object))
 	{
-		if (!CanvasPool.Contains(RenderTargetCanvas))
-		{
-			CanvasPool.Add(RenderTargetCanvas);
-			return true;
-		}
+		return ResourceCache->ReleaseCanvas(RenderTargetCanvas);
 	}
 	return false;
 }
+
+TSharedPtr<FTextureBakerPendingReadback> FTextureBakerRenderContext::BeginReadback(UTextureRenderTarget2D* SourceRT, ETextureSourceFormat ImageFormat, ETBImageNormalization Normalization)
+{
+	if (!SourceRT || CVarTextureBakerAsyncReadback.GetValueOnGameThread() == 0)
+	{
+		return nullptr;
+	}
+
+	TSharedPtr<FTextureBakerPendingReadback> Readback;
+	FTextureBakerEncodeSettings EncodeSettings;
+	if (GetGPUEncodeSettings(SourceRT, ImageFormat, Normalization, EncodeSettings))
+	{
+		Readback = MakeShared<FTextureBakerPendingReadback>(ReadbackPool, SourceRT, EncodeSettings);
+	}
+	else
+	{
+		Readback = MakeShared<FTextureBakerPendingReadback>(ReadbackPool, SourceRT);
+	}
+	return Readback->IsValid() ? Readback : nullptr;
+}
+
+int32 FTextureBakerRenderContext::GetMaxReadbacksInFlight() const
+{
+	return CVarTextureBakerAsyncReadback.GetValueOnGameThread() ? FMath::Max(1, CVarTextureBakerReadbacksInFlight.GetValueOnGameThread()) : 1;
+}
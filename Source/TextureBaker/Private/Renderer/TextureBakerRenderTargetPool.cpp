@@ -0,0 +1,176 @@
+#include "Renderer/TextureBakerRenderTargetPool.h"
+#include "ClearQuad.h"
+#include "HAL/IConsoleManager.h"
+#include "RHICommandList.h"
+#include "TextureResource.h"
+
+static TAutoConsoleVariable<int32> CVarTextureBakerRenderTargetBudget(
+	TEXT("TextureBaker.Pool.RenderTargetBudgetMB"),
+	1024,
+	TEXT("GPU memory (in MB) render targets of a bake may occupy before free pooled ones are released, least recently used first. 0 keeps nothing in the pool."),
+	ECVF_Default);
+
+int64 FTextureBakerRenderTargetPool::GetResourceBytes(const UTextureRenderTarget2D* RenderTarget)
+{
+	return int64(RenderTarget->CalcTextureMemorySizeEnum(TMC_AllMips));
+}
+
+UTextureRenderTarget2D* FTextureBakerRenderTargetPool::Acquire(const FIntPoint& Size, ETextureRenderTargetFormat Format, bool bAutoGenerateMips, const FLinearColor& ClearColor)
+{
+	check(IsInGameThread());
+	FTextureBakerRenderTargetOccupancy& FormatOccupancy = Occupancy.FindOrAdd(Format);
+	if (TArray<FFreeRenderTarget>* Bucket = FreeRenderTargets.Find(FBucketKey(Size, Format, bAutoGenerateMips)))
+	{
+		// Most recently released one is taken, it's the least likely to be evicted soon
+		while (Bucket->Num() > 0)
+		{
+			UTextureRenderTarget2D* RenderTarget = Bucket->Pop(false).RenderTarget;
+			const int64 ResourceBytes = GetResourceBytes(RenderTarget);
+			FormatOccupancy.NumFree--;
+			FormatOccupancy.FreeBytes -= ResourceBytes;
+			if (IsValid(RenderTarget))
+			{
+				FormatOccupancy.NumInUse++;
+				FormatOccupancy.InUseBytes += ResourceBytes;
+				InUseRenderTargets.Add(RenderTarget);
+				NumHits++;
+				return RenderTarget;
+			}
+			AllocatedBytes -= ResourceBytes;
+		}
+	}
+
+	// Not found - create a new one. Resource is created right away with the requested clear value
+	NumMisses++;
+	UTextureRenderTarget2D* RenderTarget = NewObject<UTextureRenderTarget2D>();
+	check(RenderTarget);
+	RenderTarget->RenderTargetFormat = Format;
+	RenderTarget->bAutoGenerateMips = bAutoGenerateMips;
+	RenderTarget->ClearColor = ClearColor;
+	RenderTarget->InitAutoFormat(Size.X, Size.Y);
+	NumCreated++;
+
+	const int64 ResourceBytes = GetResourceBytes(RenderTarget);
+	FormatOccupancy.NumInUse++;
+	FormatOccupancy.InUseBytes += ResourceBytes;
+	InUseRenderTargets.Add(RenderTarget);
+	AllocatedBytes += ResourceBytes;
+	PeakBytes = FMath::Max(PeakBytes, AllocatedBytes);
+	Trim(int64(FMath::Max(0, CVarTextureBakerRenderTargetBudget.GetValueOnGameThread())) * 1024 * 1024);
+	return RenderTarget;
+}
+
+bool FTextureBakerRenderTargetPool::Release(UTextureRenderTarget2D* RenderTarget)
+{
+	check(IsInGameThread());
+	if (!RenderTarget)
+	{
+		return false;
+	}
+	TArray<FFreeRenderTarget>& Bucket = FreeRenderTargets.FindOrAdd(FBucketKey(RenderTarget));
+	if (Bucket.ContainsByPredicate([RenderTarget](const FFreeRenderTarget& Entry) { return Entry.RenderTarget == RenderTarget; }))
+	{
+		return false;
+	}
+	Bucket.Add({ RenderTarget, ++UseClock });
+
+	const int64 ResourceBytes = GetResourceBytes(RenderTarget);
+	FTextureBakerRenderTargetOccupancy& FormatOccupancy = Occupancy.FindOrAdd(RenderTarget->RenderTargetFormat);
+	FormatOccupancy.NumFree++;
+	FormatOccupancy.FreeBytes += ResourceBytes;
+	if (InUseRenderTargets.Remove(RenderTarget) > 0)
+	{
+		FormatOccupancy.NumInUse--;
+		FormatOccupancy.InUseBytes -= ResourceBytes;
+	}
+	else
+	{
+		// Render target wasn't handed out by the pool, it's owned from now on
+		AllocatedBytes += ResourceBytes;
+		PeakBytes = FMath::Max(PeakBytes, AllocatedBytes);
+	}
+	Trim(int64(FMath::Max(0, CVarTextureBakerRenderTargetBudget.GetValueOnGameThread())) * 1024 * 1024);
+	return true;
+}
+
+void FTextureBakerRenderTargetPool::Trim(int64 BudgetBytes)
+{
+	check(IsInGameThread());
+	while (AllocatedBytes > BudgetBytes)
+	{
+		TArray<FFreeRenderTarget>* OldestBucket = nullptr;
+		for (TPair<FBucketKey, TArray<FFreeRenderTarget>>& Bucket : FreeRenderTargets)
+		{
+			if (Bucket.Value.Num() > 0 && (!OldestBucket || Bucket.Value[0].LastUse < (*OldestBucket)[0].LastUse))
+			{
+				OldestBucket = &Bucket.Value;
+			}
+		}
+		if (!OldestBucket)
+		{
+			break;
+		}
+
+		// GPU memory goes away with the resource, the object itself is left to the garbage collector
+		UTextureRenderTarget2D* RenderTarget = (*OldestBucket)[0].RenderTarget;
+		OldestBucket->RemoveAt(0, 1, false);
+		const int64 ResourceBytes = GetResourceBytes(RenderTarget);
+		FTextureBakerRenderTargetOccupancy& FormatOccupancy = Occupancy.FindOrAdd(RenderTarget->RenderTargetFormat);
+		FormatOccupancy.NumFree--;
+		FormatOccupancy.FreeBytes -= ResourceBytes;
+		AllocatedBytes -= ResourceBytes;
+		if (IsValid(RenderTarget))
+		{
+			RenderTarget->ReleaseResource();
+		}
+		NumEvicted++;
+	}
+}
+
+void FTextureBakerRenderTargetPool::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	// Render targets in use may be held by nothing else, e.g. results waiting for their readback after their render scope ended
+	for (UTextureRenderTarget2D* RenderTarget : InUseRenderTargets)
+	{
+		Collector.AddReferencedObject(RenderTarget);
+	}
+	for (TPair<FBucketKey, TArray<FFreeRenderTarget>>& Bucket : FreeRenderTargets)
+	{
+		for (FFreeRenderTarget& Entry : Bucket.Value)
+		{
+			Collector.AddReferencedObject(Entry.RenderTarget);
+		}
+	}
+}
+
+void FTextureBakerRenderTargetPool::ResetStats()
+{
+	PeakBytes = AllocatedBytes;
+	NumHits = 0;
+	NumMisses = 0;
+	NumCreated = 0;
+	NumEvicted = 0;
+}
+
+void FTextureBakerRenderTargetPool::Clear(UTextureRenderTarget2D* RenderTarget, const FLinearColor& ClearColor)
+{
+	FTextureRenderTargetResource* RenderTargetResource = RenderTarget ? RenderTarget->GameThread_GetRenderTargetResource() : nullptr;
+	if (!RenderTargetResource)
+	{
+		return;
+	}
+	ENQUEUE_RENDER_COMMAND(TextureBakerClearRTCommand)(
+		[RenderTargetResource, ClearColor](FRHICommandList& RHICmdList)
+		{
+			FRHITexture* RenderTargetTexture = RenderTargetResource->GetRenderTargetTexture();
+			const bool bFastClear = RenderTargetTexture->HasClearValue() && RenderTargetTexture->GetClearColor() == ClearColor;
+			FRHIRenderPassInfo RPInfo(RenderTargetTexture, bFastClear ? ERenderTargetActions::Clear_Store : ERenderTargetActions::DontLoad_Store);
+			TransitionRenderPassTargets(RHICmdList, RPInfo);
+			RHICmdList.BeginRenderPass(RPInfo, TEXT("ClearRT"));
+			if (!bFastClear)
+			{
+				DrawClearQuad(RHICmdList, ClearColor);
+			}
+			RHICmdList.EndRenderPass();
+		});
+}
@@ -0,0 +1,232 @@
+#include "Renderer/TextureBakerResourceCache.h"
+#include "Engine/Canvas.h"
+#include "Engine/Texture2D.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeLock.h"
+#include "TextureBaker.h"
+#include "EngineLogs.h"
+
+static TAutoConsoleVariable<int32> CVarTextureBakerDerivedArtBudget(
+	TEXT("TextureBaker.Pool.DerivedArtBudgetMB"),
+	1024,
+	TEXT("Memory (in MB) derived art textures kept for reuse may occupy, counting their source and GPU resource. Least recently used ones are dropped first."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTextureBakerReleaseDerivedArtSource(
+	TEXT("TextureBaker.Pool.ReleaseDerivedArtSource"),
+	1,
+	TEXT("Drop the source copy of derived art once it's built. Derived art passed back to the baker is resolved to its original texture."),
+	ECVF_Default);
+
+static FAutoConsoleCommand GTextureBakerFlushResourcesCommand(
+	TEXT("TextureBaker.FlushResources"),
+	TEXT("Releases render targets, canvases and derived art kept between bakes. The derived art cache on disk is kept."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		if (FTextureBakerModule* Module = FTextureBakerModule::Get())
+		{
+			Module->GetResourceCache()->Flush();
+		}
+	}));
+
+FTextureBakerResourceCache::FTextureBakerResourceCache()
+	: DerivedArtClock(0)
+	, DerivedArtBytes(0)
+{
+}
+
+UTextureRenderTarget2D* FTextureBakerResourceCache::AcquireRenderTarget(const FIntPoint& Size, ETextureRenderTargetFormat Format, bool bAutoGenerateMips, const FLinearColor& ClearColor)
+{
+	FScopeLock ScopeLock(&Lock);
+	return RenderTargetPool.Acquire(Size, Format, bAutoGenerateMips, ClearColor);
+}
+
+bool FTextureBakerResourceCache::ReleaseRenderTarget(UTextureRenderTarget2D* RenderTarget)
+{
+	FScopeLock ScopeLock(&Lock);
+	return RenderTargetPool.Release(RenderTarget);
+}
+
+UCanvas* FTextureBakerResourceCache::AcquireCanvas()
+{
+	FScopeLock ScopeLock(&Lock);
+	while (CanvasPool.Num())
+	{
+		if (UCanvas* ExistingCanvas = CanvasPool.Pop())
+		{
+			return ExistingCanvas;
+		}
+	}
+	UCanvas* CanvasForRenderingToTarget = NewObject<UCanvas>(GetTransientPackage(), NAME_None);
+	check(CanvasForRenderingToTarget);
+	return CanvasForRenderingToTarget;
+}
+
+bool FTextureBakerResourceCache::ReleaseCanvas(UCanvas* Canvas)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (Canvas && !CanvasPool.Contains(Canvas))
+	{
+		CanvasPool.Add(Canvas);
+		return true;
+	}
+	return false;
+}
+
+UTexture2D* FTextureBakerResourceCache::FindDerivedArt(const FTextureBakerDerivedArtKey& Key)
+{
+	FScopeLock ScopeLock(&Lock);
+	UTexture2D* ExistingTexture = DerivedArtPool.FindRef(Key);
+	if (!ExistingTexture)
+	{
+		return nullptr;
+	}
+	// Source of built derived art is gone on purpose, otherwise the texture was rewritten by someone
+	FDerivedArtUsage* Usage = DerivedArtUsage.Find(ExistingTexture);
+	if (!Usage || !IsValid(ExistingTexture) || !(Usage->bSourceReleased || ExistingTexture->Source.IsValid()))
+	{
+		RemoveDerivedArt(ExistingTexture);
+		return nullptr;
+	}
+	Usage->LastUse = ++DerivedArtClock;
+	return ExistingTexture;
+}
+
+void FTextureBakerResourceCache::AddDerivedArt(const FTextureBakerDerivedArtKey& Key, UTexture2D* Texture, int64 Bytes, int64 SourceBytes, UTexture2D* OriginalTexture)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (UTexture2D* ReplacedTexture = DerivedArtPool.FindRef(Key))
+	{
+		RemoveDerivedArt(ReplacedTexture);
+	}
+	DerivedArtPool.Add(Key, Texture);
+	DerivedArtUsage.Add(Texture, { ++DerivedArtClock, Bytes, SourceBytes, false });
+	DerivedArtOriginals.Add(Texture, OriginalTexture);
+	DerivedArtBytes += Bytes;
+	TrimDerivedArtPool(Texture);
+}
+
+bool FTextureBakerResourceCache::RemoveDerivedArt(UTexture2D* Texture)
+{
+	FScopeLock ScopeLock(&Lock);
+	bool bFoundAnything = false;
+	for (auto It = DerivedArtPool.CreateIterator(); It; ++It)
+	{
+		if (It.Value() == Texture)
+		{
+			It.RemoveCurrent();
+			bFoundAnything = true;
+		}
+	}
+	FDerivedArtUsage Usage;
+	if (DerivedArtUsage.RemoveAndCopyValue(Texture, Usage))
+	{
+		DerivedArtBytes -= Usage.Bytes;
+	}
+	return bFoundAnything;
+}
+
+void FTextureBakerResourceCache::ReleaseDerivedArtSource(UTexture2D* Texture)
+{
+	check(IsInGameThread());
+	FScopeLock ScopeLock(&Lock);
+	FDerivedArtUsage* Usage = DerivedArtUsage.Find(Texture);
+	if (!Usage || Usage->bSourceReleased || CVarTextureBakerReleaseDerivedArtSource.GetValueOnGameThread() == 0)
+	{
+		return;
+	}
+
+	// Platform data and the resource stay, the texture isn't rebuilt without a source
+	Texture->Source.RemoveSourceData();
+	Usage->bSourceReleased = true;
+	Usage->Bytes -= Usage->SourceBytes;
+	DerivedArtBytes -= Usage->SourceBytes;
+}
+
+UTexture2D* FTextureBakerResourceCache::FindDerivedArtOriginal(UTexture2D* Texture) const
+{
+	FScopeLock ScopeLock(&Lock);
+	const TWeakObjectPtr<UTexture2D>* OriginalTexture = Texture ? DerivedArtOriginals.Find(Texture) : nullptr;
+	UTexture2D* Original = OriginalTexture ? OriginalTexture->Get() : nullptr;
+	return Original ? Original : Texture;
+}
+
+void FTextureBakerResourceCache::TrimDerivedArtPool(const UTexture2D* KeepTexture)
+{
+	const int64 BudgetBytes = int64(FMath::Max(0, CVarTextureBakerDerivedArtBudget.GetValueOnAnyThread())) * 1024 * 1024;
+	while (DerivedArtBytes > BudgetBytes)
+	{
+		UTexture2D* OldestTexture = nullptr;
+		uint64 OldestUse = MAX_uint64;
+		for (const TPair<UTexture2D*, FDerivedArtUsage>& Usage : DerivedArtUsage)
+		{
+			if (Usage.Key != KeepTexture && Usage.Value.LastUse < OldestUse)
+			{
+				OldestTexture = Usage.Key;
+				OldestUse = Usage.Value.LastUse;
+			}
+		}
+		if (!OldestTexture)
+		{
+			break;
+		}
+
+		// Scopes still using the texture keep it, otherwise it's left to the garbage collector
+		RemoveDerivedArt(OldestTexture);
+	}
+}
+
+void FTextureBakerResourceCache::Flush()
+{
+	check(IsInGameThread());
+	FScopeLock ScopeLock(&Lock);
+	const int32 NumDerivedArt = DerivedArtUsage.Num();
+	const int64 FlushedBytes = RenderTargetPool.GetAllocatedBytes() + DerivedArtBytes;
+	RenderTargetPool.Trim(0);
+	const int64 RenderTargetsInUseBytes = RenderTargetPool.GetAllocatedBytes();
+	CanvasPool.Empty();
+	DerivedArtPool.Empty();
+	DerivedArtUsage.Empty();
+	DerivedArtOriginals.Empty();
+	DerivedArtBytes = 0;
+	DerivedArtCache.Flush();
+	UE_LOG(LogTexture, Log, TEXT("Flushed TextureBaker resources, %d derived art textures, %.1f MB"), NumDerivedArt, (FlushedBytes - RenderTargetsInUseBytes) / (1024.0 * 1024.0));
+}
+
+void FTextureBakerResourceCache::ResetStats()
+{
+	FScopeLock ScopeLock(&Lock);
+	RenderTargetPool.ResetStats();
+	DerivedArtCache.ResetStats();
+}
+
+void FTextureBakerResourceCache::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	FScopeLock ScopeLock(&Lock);
+	for (TPair<FTextureBakerDerivedArtKey, UTexture2D*>& DerivedArtEntry : DerivedArtPool)
+	{
+		Collector.AddReferencedObject(DerivedArtEntry.Value);
+	}
+	RenderTargetPool.AddReferencedObjects(Collector);
+	Collector.AddReferencedObjects(CanvasPool);
+
+	for (auto It = DerivedArtPool.CreateIterator(); It; ++It)
+	{
+		if (!IsValid(It.Value()))
+		{
+			if (const FDerivedArtUsage* Usage = DerivedArtUsage.Find(It.Value()))
+			{
+				DerivedArtBytes -= Usage->Bytes;
+				DerivedArtUsage.Remove(It.Value());
+			}
+			It.RemoveCurrent();
+		}
+	}
+	for (auto It = DerivedArtOriginals.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
@@ -0,0 +1,633 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/VectorRegister.h"
+#include "Math/Float16Color.h"
+#include "Engine/Texture.h"
+
+#if PLATFORM_LITTLE_ENDIAN
+ #define _ToPackedBGRA ToPackedARGB
+ #define _ToPackedRGBA ToPackedABGR
+#else // PLATFORM_LITTLE_ENDIAN
+ #define _ToPackedBGRA ToPackedBGRA
+ #define _ToPackedRGBA ToPackedRGBA
+#endif // !PLATFORM_LITTLE_ENDIAN
+
+// Vector kernels assemble output words in little endian lane order, so they are only enabled where it matches memory layout
+#define TEXTUREBAKER_VECTOR_TRANSCODE (PLATFORM_ENABLE_VECTORINTRINSICS && PLATFORM_LITTLE_ENDIAN)
+
+/**
+ * Pixel encoders used by readback handlers. Every encoder provides:
+ *  - Encode: scalar reference conversion of a single pixel
+ *  - Encode4: conversion of 4 contiguous pixels. All source pixels are loaded before anything is written, so it is safe
+ *    to use on overlapping buffers as long as the caller walks them in a non-destructive direction.
+ * Vector kernels are required to produce exactly the same bits as the scalar reference.
+ */
+namespace TextureBakerTranscoders
+{
+#if TEXTUREBAKER_VECTOR_TRANSCODE
+	FORCEINLINE VectorRegisterInt VectorIntReplicate(int32 Value) { return MakeVectorRegisterInt(Value, Value, Value, Value); }
+
+	// Converts 4 FLinearColor pixels (AoS) to per-channel registers (SoA)
+	FORCEINLINE void VectorLoadTransposed4(const FLinearColor* Src, VectorRegister& OutR, VectorRegister& OutG, VectorRegister& OutB, VectorRegister& OutA)
+	{
+		const VectorRegister P0 = VectorLoad(&Src[0]);
+		const VectorRegister P1 = VectorLoad(&Src[1]);
+		const VectorRegister P2 = VectorLoad(&Src[2]);
+		const VectorRegister P3 = VectorLoad(&Src[3]);
+		const VectorRegister RG01 = VectorShuffle(P0, P1, 0, 1, 0, 1);
+		const VectorRegister RG23 = VectorShuffle(P2, P3, 0, 1, 0, 1);
+		const VectorRegister BA01 = VectorShuffle(P0, P1, 2, 3, 2, 3);
+		const VectorRegister BA23 = VectorShuffle(P2, P3, 2, 3, 2, 3);
+		OutR = VectorShuffle(RG01, RG23, 0, 2, 0, 2);
+		OutG = VectorShuffle(RG01, RG23, 1, 3, 1, 3);
+		OutB = VectorShuffle(BA01, BA23, 0, 2, 0, 2);
+		OutA = VectorShuffle(BA01, BA23, 1, 3, 1, 3);
+	}
+
+	// Matches FMath::Clamp(Value, 0, 1), including NaN which clamps to 1
+	FORCEINLINE VectorRegister VectorSaturate(const VectorRegister& Value)
+	{
+		return VectorMax(VectorMin(Value, VectorOne()), VectorZero());
+	}
+
+	// Matches FLinearColor::GetLuminance evaluation order
+	FORCEINLINE VectorRegister VectorLuminance(const VectorRegister& R, const VectorRegister& G, const VectorRegister& B)
+	{
+		const VectorRegister RG = VectorAdd(VectorMultiply(R, VectorSetFloat1(0.3f)), VectorMultiply(G, VectorSetFloat1(0.59f)));
+		return VectorAdd(RG, VectorMultiply(B, VectorSetFloat1(0.11f)));
+	}
+
+	// Packs 4 lanes of 8 bit values into 4 bytes per lane
+	FORCEINLINE VectorRegisterInt VectorPackBytes(const VectorRegisterInt& Byte0, const VectorRegisterInt& Byte1, const VectorRegisterInt& Byte2, const VectorRegisterInt& Byte3)
+	{
+		return VectorIntOr(VectorIntOr(Byte0, VectorShiftLeftImm(Byte1, 8)), VectorIntOr(VectorShiftLeftImm(Byte2, 16), VectorShiftLeftImm(Byte3, 24)));
+	}
+
+	// Interleaves two registers containing low and high words of 4 pixels
+	FORCEINLINE void VectorStoreInterleaved(const VectorRegisterInt& Lo, const VectorRegisterInt& Hi, void* Dest)
+	{
+		const VectorRegister LoF = VectorCastIntToFloat(Lo);
+		const VectorRegister HiF = VectorCastIntToFloat(Hi);
+		const VectorRegister Pair01 = VectorSwizzle(VectorShuffle(LoF, HiF, 0, 1, 0, 1), 0, 2, 1, 3);
+		const VectorRegister Pair23 = VectorSwizzle(VectorShuffle(LoF, HiF, 2, 3, 2, 3), 0, 2, 1, 3);
+		VectorIntStore(VectorCastFloatToInt(Pair01), Dest);
+		VectorIntStore(VectorCastFloatToInt(Pair23), reinterpret_cast<uint8*>(Dest) + 16);
+	}
+
+	// Packs the low 16 bits of 4 lanes into 8 bytes
+	FORCEINLINE void VectorStoreWords4(const VectorRegisterInt& Value, void* Dest)
+	{
+		MS_ALIGN(16) uint32 Lanes[4] GCC_ALIGN(16);
+		VectorIntStoreAligned(Value, Lanes);
+		uint16* DestWords = reinterpret_cast<uint16*>(Dest);
+		DestWords[0] = static_cast<uint16>(Lanes[0]);
+		DestWords[1] = static_cast<uint16>(Lanes[1]);
+		DestWords[2] = static_cast<uint16>(Lanes[2]);
+		DestWords[3] = static_cast<uint16>(Lanes[3]);
+	}
+
+	// Packs the low 8 bits of 4 lanes into 4 bytes
+	FORCEINLINE void VectorStoreBytes4(const VectorRegisterInt& Value, void* Dest)
+	{
+		const VectorRegisterInt ByteMask = VectorIntReplicate(0xFF);
+		MS_ALIGN(16) uint32 Lanes[4] GCC_ALIGN(16);
+		VectorIntStoreAligned(VectorIntAnd(Value, ByteMask), Lanes);
+		*reinterpret_cast<uint32*>(Dest) = Lanes[0] | (Lanes[1] << 8) | (Lanes[2] << 16) | (Lanes[3] << 24);
+	}
+
+	// Bit exact vector version of FFloat16::Set for normal, zero and overflowing inputs. Returns false if any lane
+	// would produce a half denormal: those require a per-lane variable shift and are left to the scalar path.
+	FORCEINLINE bool VectorFloatToHalfBits(const VectorRegister& Value, VectorRegisterInt& OutHalf)
+	{
+		const VectorRegisterInt Bits = VectorCastFloatToInt(Value);
+		const VectorRegisterInt Sign = VectorIntAnd(VectorShiftRightImmLogical(Bits, 16), VectorIntReplicate(0x8000));
+		const VectorRegisterInt Exponent = VectorIntAnd(VectorShiftRightImmLogical(Bits, 23), VectorIntReplicate(0xFF));
+		const VectorRegisterInt Mantissa = VectorIntAnd(Bits, VectorIntReplicate(0x7FFFFF));
+
+		const VectorRegisterInt IsOverflow = VectorIntCompareGT(Exponent, VectorIntReplicate(142));
+		const VectorRegisterInt IsZero = VectorIntCompareGT(VectorIntReplicate(102), Exponent);
+		const VectorRegisterInt IsDenormal = VectorIntAndNot(IsZero, VectorIntCompareGT(VectorIntReplicate(113), Exponent));
+		if (VectorMaskBits(VectorCastIntToFloat(IsDenormal)))
+		{
+			return false;
+		}
+
+		const VectorRegisterInt Normal = VectorIntOr(VectorIntOr(Sign, VectorShiftLeftImm(VectorIntSubtract(Exponent, VectorIntReplicate(112)), 10)), VectorShiftRightImmLogical(Mantissa, 13));
+		const VectorRegisterInt Saturated = VectorIntOr(Sign, VectorIntReplicate(0x7BFF));
+		OutHalf = VectorIntSelect(IsOverflow, Saturated, VectorIntSelect(IsZero, Sign, Normal));
+		return true;
+	}
+#endif // TEXTUREBAKER_VECTOR_TRANSCODE
+
+	// Reads 4 pixels into a local copy, so that encoders which fall back to scalar code never read overwritten data
+	template <typename T> FORCEINLINE void CopyPixels4(T (&Local)[4], const T* Src)
+	{
+		FMemory::Memcpy(Local, Src, sizeof(T) * 4);
+	}
+
+	struct FLinearToUNorm8
+	{
+		typedef FLinearColor SourceType;
+
+		// Vector version of FLinearColor::ToFColor(false): FloorToInt of positive values is a truncation
+		template <int32 Channel0, int32 Channel1, int32 Channel2, int32 Channel3>
+		FORCEINLINE static void Encode4(void* Dest, const FLinearColor* Src)
+		{
+#if TEXTUREBAKER_VECTOR_TRANSCODE
+			VectorRegister Channels[4];
+			VectorLoadTransposed4(Src, Channels[0], Channels[1], Channels[2], Channels[3]);
+			const VectorRegister Scale = VectorSetFloat1(255.999f);
+			const VectorRegisterInt Packed = VectorPackBytes(
+				VectorFloatToInt(VectorMultiply(VectorSaturate(Channels[Channel0]), Scale)),
+				VectorFloatToInt(VectorMultiply(VectorSaturate(Channels[Channel1]), Scale)),
+				VectorFloatToInt(VectorMultiply(VectorSaturate(Channels[Channel2]), Scale)),
+				VectorFloatToInt(VectorMultiply(VectorSaturate(Channels[Channel3]), Scale)));
+			VectorIntStore(Packed, Dest);
+#endif // TEXTUREBAKER_VECTOR_TRANSCODE
+		}
+	};
+
+	struct FLinearToBGRA8
+	{
+		typedef FLinearColor SourceType;
+		static constexpr int64 DestSize = 4;
+
+		FORCEINLINE static void Encode(void* Dest, const FLinearColor Src, bool bSRGB)
+		{
+			*reinterpret_cast<uint32*>(Dest) = Src.ToFColor(bSRGB)._ToPackedBGRA();
+		}
+
+		FORCEINLINE static void Encode4(void* Dest, const FLinearColor* Src, bool bSRGB)
+		{
+#if TEXTUREBAKER_VECTOR_TRANSCODE
+			if (!bSRGB)
+			{
+				FLinearToUNorm8::Encode4<2, 1, 0, 3>(Dest, Src);
+				return;
+			}
+#endif // TEXTUREBAKER_VECTOR_TRANSCODE
+			// Gamma curve uses FMath::Pow and can't be reproduced bit exact with vector math
+			FLinearColor Local[4];
+			CopyPixels4(Local, Src);
+			for (int32 Index = 0; Index < 4; Index++)
+			{
+				Encode(reinterpret_cast<uint32*>(Dest) + Index, Local[Index], bSRGB);
+			}
+		}
+	};
+
+	struct FLinearToRGBA8
+	{
+		typedef FLinearColor SourceType;
+		static constexpr int64 DestSize = 4;
+
+		FORCEINLINE static void Encode(void* Dest, const FLinearColor Src, bool bSRGB)
+		{
+			*reinterpret_cast<uint32*>(Dest) = Src.ToFColor(false)._ToPackedRGBA();
+		}
+
+		FORCEINLINE static void Encode4(void* Dest, const FLinearColor* Src, bool bSRGB)
+		{
+#if TEXTUREBAKER_VECTOR_TRANSCODE
+			FLinearToUNorm8::Encode4<0, 1, 2, 3>(Dest, Src);
+#else // TEXTUREBAKER_VECTOR_TRANSCODE
+			FLinearColor Local[4];
+			CopyPixels4(Local, Src);
+			for (int32 Index = 0; Index < 4; Index++)
+			{
+				Encode(reinterpret_cast<uint32*>(Dest) + Index, Local[Index], bSRGB);
+			}
+#endif // !TEXTUREBAKER_VECTOR_TRANSCODE
+		}
+	};
+
+	template <bool bBGRAOrder> struct TLinearToRGBE
+	{
+		typedef FLinearColor SourceType;
+		static constexpr int64 DestSize = 4;
+
+		FORCEINLINE static void Encode(void* Dest, const FLinearColor Src, bool bSRGB)
+		{
+			*reinterpret_cast<uint32*>(Dest) = bBGRAOrder ? Src.ToRGBE()._ToPackedBGRA() : Src.ToRGBE()._ToPackedRGBA();
+		}
+
+		FORCEINLINE static void Encode4(void* Dest, const FLinearColor* Src, bool bSRGB)
+		{
+#if TEXTUREBAKER_VECTOR_TRANSCODE
+			VectorRegister R, G, B, A;
+			VectorLoadTransposed4(Src, R, G, B, A);
+
+			// Exponent extraction stays scalar to keep the exact frexp / division sequence of FLinearColor::ToRGBE
+			MS_ALIGN(16) float Primary[4] GCC_ALIGN(16);
+			MS_ALIGN(16) float Scale[4] GCC_ALIGN(16);
+			MS_ALIGN(16) int32 SharedExponent[4] GCC_ALIGN(16);
+			VectorStoreAligned(VectorMax(VectorMax(R, G), B), Primary);
+			for (int32 Index = 0; Index < 4; Index++)
+			{
+				if (Primary[Index] < 1E-32)
+				{
+					Scale[Index] = 0.0f;
+					SharedExponent[Index] = 0;
+				}
+				else
+				{
+					int32 Exponent;
+					Scale[Index] = frexp(Primary[Index], &Exponent) / Primary[Index] * 255.f;
+					SharedExponent[Index] = FMath::Clamp(FMath::TruncToInt(Exponent), -128, 127) + 128;
+				}
+			}
+
+			// Clamp order maps NaN to 0, which is what Clamp(TruncToInt(NaN), 0, 255) produces
+			const VectorRegister ScaleVector = VectorLoadAligned(Scale);
+			const VectorRegister MaxByte = VectorSetFloat1(255.0f);
+			const VectorRegisterInt EncodedR = VectorFloatToInt(VectorMin(VectorMax(VectorMultiply(R, ScaleVector), VectorZero()), MaxByte));
+			const VectorRegisterInt EncodedG = VectorFloatToInt(VectorMin(VectorMax(VectorMultiply(G, ScaleVector), VectorZero()), MaxByte));
+			const VectorRegisterInt EncodedB = VectorFloatToInt(VectorMin(VectorMax(VectorMultiply(B, ScaleVector), VectorZero()), MaxByte));
+			const VectorRegisterInt EncodedE = VectorIntLoadAligned(SharedExponent);
+			VectorIntStore(bBGRAOrder ? VectorPackBytes(EncodedB, EncodedG, EncodedR, EncodedE) : VectorPackBytes(EncodedR, EncodedG, EncodedB, EncodedE), Dest);
+#else // TEXTUREBAKER_VECTOR_TRANSCODE
+			FLinearColor Local[4];
+			CopyPixels4(Local, Src);
+			for (int32 Index = 0; Index < 4; Index++)
+			{
+				Encode(reinterpret_cast<uint32*>(Dest) + Index, Local[Index], bSRGB);
+			}
+#endif // !TEXTUREBAKER_VECTOR_TRANSCODE
+		}
+	};
+
+	template <typename TChannel> struct TLinearToLuminance
+	{
+		typedef FLinearColor SourceType;
+		static constexpr int64 DestSize = sizeof(TChannel);
+		static constexpr float ChannelScale = (sizeof(TChannel) == 1) ? 255.0f : 65535.0f;
+
+		// Unclamped, as it was always written: out of range values wrap the same way in both paths
+		FORCEINLINE static void Encode(void* Dest, const FLinearColor Src, bool bSRGB)
+		{
+			*reinterpret_cast<TChannel*>(Dest) = Src.GetLuminance() * ChannelScale;
+		}
+
+		FORCEINLINE static void Encode4(void* Dest, const FLinearColor* Src, bool bSRGB)
+		{
+#if TEXTUREBAKER_VECTOR_TRANSCODE
+			VectorRegister R, G, B, A;
+			VectorLoadTransposed4(Src, R, G, B, A);
+			const VectorRegisterInt Encoded = VectorFloatToInt(VectorMultiply(VectorLuminance(R, G, B), VectorSetFloat1(ChannelScale)));
+			if (sizeof(TChannel) == 1)
+			{
+				VectorStoreBytes4(Encoded, Dest);
+			}
+			else
+			{
+				VectorStoreWords4(Encoded, Dest);
+			}
+#else // TEXTUREBAKER_VECTOR_TRANSCODE
+			FLinearColor Local[4];
+			CopyPixels4(Local, Src);
+			for (int32 Index = 0; Index < 4; Index++)
+			{
+				Encode(reinterpret_cast<TChannel*>(Dest) + Index, Local[Index], bSRGB);
+			}
+#endif // !TEXTUREBAKER_VECTOR_TRANSCODE
+		}
+	};
+
+	struct FLinearToRGBA16
+	{
+		typedef FLinearColor SourceType;
+		static constexpr int64 DestSize = 8;
+
+		FORCEINLINE static void Encode(void* Dest, const FLinearColor Src, bool bSRGB)
+		{
+			reinterpret_cast<uint16*>(Dest)[0] = FMath::Clamp(Src.R, 0.0f, 1.0f) * 65535;
+			reinterpret_cast<uint16*>(Dest)[1] = FMath::Clamp(Src.G, 0.0f, 1.0f) * 65535;
+			reinterpret_cast<uint16*>(Dest)[2] = FMath::Clamp(Src.B, 0.0f, 1.0f) * 65535;
+			reinterpret_cast<uint16*>(Dest)[3] = FMath::Clamp(Src.A, 0.0f, 1.0f) * 65535;
+		}
+
+		FORCEINLINE static void Encode4(void* Dest, const FLinearColor* Src, bool bSRGB)
+		{
+#if TEXTUREBAKER_VECTOR_TRANSCODE
+			VectorRegister R, G, B, A;
+			VectorLoadTransposed4(Src, R, G, B, A);
+			const VectorRegister Scale = VectorSetFloat1(65535.0f);
+			const VectorRegisterInt EncodedR = VectorFloatToInt(VectorMultiply(VectorSaturate(R), Scale));
+			const VectorRegisterInt EncodedG = VectorFloatToInt(VectorMultiply(VectorSaturate(G), Scale));
+			const VectorRegisterInt EncodedB = VectorFloatToInt(VectorMultiply(VectorSaturate(B), Scale));
+			const VectorRegisterInt EncodedA = VectorFloatToInt(VectorMultiply(VectorSaturate(A), Scale));
+			VectorStoreInterleaved(VectorIntOr(EncodedR, VectorShiftLeftImm(EncodedG, 16)), VectorIntOr(EncodedB, VectorShiftLeftImm(EncodedA, 16)), Dest);
+#else // TEXTUREBAKER_VECTOR_TRANSCODE
+			FLinearColor Local[4];
+			CopyPixels4(Local, Src);
+			for (int32 Index = 0; Index < 4; Index++)
+			{
+				Encode(reinterpret_cast<uint8*>(Dest) + Index * DestSize, Local[Index], bSRGB);
+			}
+#endif // !TEXTUREBAKER_VECTOR_TRANSCODE
+		}
+	};
+
+	struct FLinearToRGBA16F
+	{
+		typedef FLinearColor SourceType;
+		static constexpr int64 DestSize = 8;
+
+		FORCEINLINE static void Encode(void* Dest, const FLinearColor Src, bool bSRGB)
+		{
+			*reinterpret_cast<FFloat16Color*>(Dest) = FFloat16Color(Src);
+		}
+
+		FORCEINLINE static void Encode4(void* Dest, const FLinearColor* Src, bool bSRGB)
+		{
+#if TEXTUREBAKER_VECTOR_TRANSCODE
+			VectorRegister R, G, B, A;
+			VectorLoadTransposed4(Src, R, G, B, A);
+			VectorRegisterInt HalfR, HalfG, HalfB, HalfA;
+			if (VectorFloatToHalfBits(R, HalfR) && VectorFloatToHalfBits(G, HalfG) && VectorFloatToHalfBits(B, HalfB) && VectorFloatToHalfBits(A, HalfA))
+			{
+				VectorStoreInterleaved(VectorIntOr(HalfR, VectorShiftLeftImm(HalfG, 16)), VectorIntOr(HalfB, VectorShiftLeftImm(HalfA, 16)), Dest);
+				return;
+			}
+#endif // TEXTUREBAKER_VECTOR_TRANSCODE
+			FLinearColor Local[4];
+			CopyPixels4(Local, Src);
+			for (int32 Index = 0; Index < 4; Index++)
+			{
+				Encode(reinterpret_cast<FFloat16Color*>(Dest) + Index, Local[Index], bSRGB);
+			}
+		}
+	};
+
+	struct FColorToBGRA8
+	{
+		typedef FColor SourceType;
+		static constexpr int64 DestSize = 4;
+
+		FORCEINLINE static void Encode(void* Dest, const FColor Src, bool bSRGB)
+		{
+			*reinterpret_cast<uint32*>(Dest) = Src._ToPackedBGRA();
+		}
+
+		FORCEINLINE static void Encode4(void* Dest, const FColor* Src, bool bSRGB)
+		{
+#if TEXTUREBAKER_VECTOR_TRANSCODE
+			VectorIntStore(VectorIntLoad(Src), Dest);
+#else // TEXTUREBAKER_VECTOR_TRANSCODE
+			FColor Local[4];
+			CopyPixels4(Local, Src);
+			FMemory::Memcpy(Dest, Local, sizeof(Local));
+#endif // !TEXTUREBAKER_VECTOR_TRANSCODE
+		}
+	};
+
+	struct FColorToRGBA8
+	{
+		typedef FColor SourceType;
+		static constexpr int64 DestSize = 4;
+
+		FORCEINLINE static void Encode(void* Dest, const FColor Src, bool bSRGB)
+		{
+			*reinterpret_cast<uint32*>(Dest) = Src._ToPackedRGBA();
+		}
+
+		FORCEINLINE static void Encode4(void* Dest, const FColor* Src, bool bSRGB)
+		{
+#if TEXTUREBAKER_VECTOR_TRANSCODE
+			// FColor is stored as BGRA, swap the R and B bytes of every pixel
+			const VectorRegisterInt Pixels = VectorIntLoad(Src);
+			const VectorRegisterInt ByteMask = VectorIntReplicate(0xFF);
+			const VectorRegisterInt Kept = VectorIntAnd(Pixels, VectorIntReplicate(0xFF00FF00));
+			const VectorRegisterInt Red = VectorIntAnd(VectorShiftRightImmLogical(Pixels, 16), ByteMask);
+			const VectorRegisterInt Blue = VectorShiftLeftImm(VectorIntAnd(Pixels, ByteMask), 16);
+			VectorIntStore(VectorIntOr(Kept, VectorIntOr(Red, Blue)), Dest);
+#else // TEXTUREBAKER_VECTOR_TRANSCODE
+			FColor Local[4];
+			CopyPixels4(Local, Src);
+			for (int32 Index = 0; Index < 4; Index++)
+			{
+				Encode(reinterpret_cast<uint32*>(Dest) + Index, Local[Index], bSRGB);
+			}
+#endif // !TEXTUREBAKER_VECTOR_TRANSCODE
+		}
+	};
+
+	// FColor input converted through FLinearColor(FColor) (sRGB table lookup) and encoded by a linear encoder
+	template <typename TLinearEncoder> struct TColorViaLinear
+	{
+		typedef FColor SourceType;
+		static constexpr int64 DestSize = TLinearEncoder::DestSize;
+
+		FORCEINLINE static void Encode(void* Dest, const FColor Src, bool bSRGB)
+		{
+			TLinearEncoder::Encode(Dest, FLinearColor(Src), bSRGB);
+		}
+
+		FORCEINLINE static void Encode4(void* Dest, const FColor* Src, bool bSRGB)
+		{
+			const FLinearColor Local[4] = { FLinearColor(Src[0]), FLinearColor(Src[1]), FLinearColor(Src[2]), FLinearColor(Src[3]) };
+			TLinearEncoder::Encode4(Dest, Local, bSRGB);
+		}
+	};
+
+	// Two channel 8 bit surface pixel (PF_R8G8)
+	struct FTextureBakerRG8Pixel
+	{
+		uint8 R;
+		uint8 G;
+	};
+
+	// Widening of native surface pixels to the pixel types the regular encoders consume. 8 bit surfaces widen to FColor the same way
+	// ReadPixels expands them, float surfaces widen to FLinearColor
+	FORCEINLINE FColor WidenPixel(const uint8 Src) { return FColor(Src, Src, Src, 255); }
+	FORCEINLINE FColor WidenPixel(const FTextureBakerRG8Pixel Src) { return FColor(Src.R, Src.G, 0, 255); }
+	FORCEINLINE FLinearColor WidenPixel(const FFloat16 Src) { const float Value = Src.GetFloat(); return FLinearColor(Value, Value, Value, 1.0f); }
+	FORCEINLINE FLinearColor WidenPixel(const FFloat16Color& Src) { return FLinearColor(Src); }
+
+	template <typename TNativePixel> struct TWidePixel { typedef decltype(WidenPixel(DeclVal<TNativePixel>())) Type; };
+
+	// Native surface pixel widened by WidenPixel and encoded by an encoder of the wide type
+	template <typename TNativePixel, typename TWideEncoder> struct TNativeViaWide
+	{
+		typedef TNativePixel SourceType;
+		static constexpr int64 DestSize = TWideEncoder::DestSize;
+
+		FORCEINLINE static void Encode(void* Dest, const TNativePixel Src, bool bSRGB)
+		{
+			TWideEncoder::Encode(Dest, WidenPixel(Src), bSRGB);
+		}
+
+		FORCEINLINE static void Encode4(void* Dest, const TNativePixel* Src, bool bSRGB)
+		{
+			const typename TWideEncoder::SourceType Local[4] = { WidenPixel(Src[0]), WidenPixel(Src[1]), WidenPixel(Src[2]), WidenPixel(Src[3]) };
+			TWideEncoder::Encode4(Dest, Local, bSRGB);
+		}
+	};
+
+	// Surface pixel which already has the image layout
+	template <typename TNativePixel> struct TCopyPixel
+	{
+		typedef TNativePixel SourceType;
+		static constexpr int64 DestSize = sizeof(TNativePixel);
+
+		FORCEINLINE static void Encode(void* Dest, const TNativePixel Src, bool bSRGB)
+		{
+			FMemory::Memcpy(Dest, &Src, sizeof(TNativePixel));
+		}
+
+		FORCEINLINE static void Encode4(void* Dest, const TNativePixel* Src, bool bSRGB)
+		{
+			TNativePixel Local[4];
+			CopyPixels4(Local, Src);
+			FMemory::Memcpy(Dest, Local, sizeof(Local));
+		}
+	};
+
+	// Single channel half to 16 bit unorm, same quantization as FLinearToRGBA16
+	struct FHalfToG16
+	{
+		typedef FFloat16 SourceType;
+		static constexpr int64 DestSize = 2;
+
+		FORCEINLINE static void Encode(void* Dest, const FFloat16 Src, bool bSRGB)
+		{
+			*reinterpret_cast<uint16*>(Dest) = FMath::Clamp(Src.GetFloat(), 0.0f, 1.0f) * 65535;
+		}
+
+		FORCEINLINE static void Encode4(void* Dest, const FFloat16* Src, bool bSRGB)
+		{
+			FFloat16 Local[4];
+			CopyPixels4(Local, Src);
+			for (int32 Index = 0; Index < 4; Index++)
+			{
+				Encode(reinterpret_cast<uint16*>(Dest) + Index, Local[Index], bSRGB);
+			}
+		}
+	};
+
+	// Transcodes PixelNum tightly packed pixels. Pixel I is read from SrcPixels[I] and written to DestPixels[I].
+	typedef void (*FTextureBakerTranscodeFunc)(void* DestPixels, const void* SrcPixels, uint64 PixelNum);
+
+	/**
+	 * Transcoder specialized on encoder, sRGB mode and vectorization. Walk direction is the only thing left for the caller:
+	 * - Forward walks from the first pixel and is safe for overlapping buffers when the output pixel is not larger than the input one
+	 * - Reverse walks from the last pixel and is safe for overlapping buffers when the output pixel is not smaller than the input one
+	 */
+	template <typename TEncoder, bool bSRGB, bool bReverse, bool bVectorized> void TranscodeSpan(void* DestPixels, const void* SrcPixels, uint64 PixelNum)
+	{
+		typedef typename TEncoder::SourceType SourceType;
+		constexpr int64 DestSize = TEncoder::DestSize;
+
+		uint8* DestBytes = reinterpret_cast<uint8*>(DestPixels);
+		const SourceType* Src = reinterpret_cast<const SourceType*>(SrcPixels);
+
+		if (bReverse)
+		{
+			uint64 Remaining = PixelNum;
+			if (bVectorized)
+			{
+				for (; Remaining >= 4; Remaining -= 4)
+				{
+					TEncoder::Encode4(DestBytes + (Remaining - 4) * DestSize, Src + (Remaining - 4), bSRGB);
+				}
+			}
+			for (; Remaining > 0; Remaining--)
+			{
+				TEncoder::Encode(DestBytes + (Remaining - 1) * DestSize, Src[Remaining - 1], bSRGB);
+			}
+		}
+		else
+		{
+			uint64 PixelIndex = 0;
+			if (bVectorized)
+			{
+				for (; PixelIndex + 4 <= PixelNum; PixelIndex += 4)
+				{
+					TEncoder::Encode4(DestBytes + PixelIndex * DestSize, Src + PixelIndex, bSRGB);
+				}
+			}
+			for (; PixelIndex < PixelNum; PixelIndex++)
+			{
+				TEncoder::Encode(DestBytes + PixelIndex * DestSize, Src[PixelIndex], bSRGB);
+			}
+		}
+	}
+
+	// Ready-made pair of transcoding loops for one (source type, image format, sRGB) combination
+	struct FTextureBakerTranscoder
+	{
+		FTextureBakerTranscoder() : Forward(nullptr), Reverse(nullptr), SourcePixelSize(0), DestPixelSize(0) {}
+		FTextureBakerTranscoder(FTextureBakerTranscodeFunc InForward, FTextureBakerTranscodeFunc InReverse, uint64 InSourcePixelSize, uint64 InDestPixelSize) :
+			Forward(InForward), Reverse(InReverse), SourcePixelSize(InSourcePixelSize), DestPixelSize(InDestPixelSize) {}
+
+		bool IsValid() const { return Forward != nullptr && Reverse != nullptr; }
+
+		FTextureBakerTranscodeFunc Forward;
+		FTextureBakerTranscodeFunc Reverse;
+		uint64 SourcePixelSize;
+		uint64 DestPixelSize;
+	};
+
+	template <typename TEncoder, bool bSRGB, bool bVectorized> FTextureBakerTranscoder MakeTranscoder()
+	{
+		return FTextureBakerTranscoder(
+			&TranscodeSpan<TEncoder, bSRGB, false, bVectorized>,
+			&TranscodeSpan<TEncoder, bSRGB, true, bVectorized>,
+			sizeof(typename TEncoder::SourceType), TEncoder::DestSize);
+	}
+
+	// Maps (source pixel type, image format) to an encoder. Native surface pixels go through the encoder of their wide type unless specialized
+	template <typename TSource, ETextureSourceFormat Format> struct TEncoderFor
+	{
+		typedef TNativeViaWide<TSource, typename TEncoderFor<typename TWidePixel<TSource>::Type, Format>::Type> Type;
+	};
+
+	template <> struct TEncoderFor<FLinearColor, TSF_BGRA8> { typedef FLinearToBGRA8 Type; };
+	template <> struct TEncoderFor<FLinearColor, TSF_BGRE8> { typedef TLinearToRGBE<true> Type; };
+	template <> struct TEncoderFor<FLinearColor, TSF_G16> { typedef TLinearToLuminance<uint16> Type; };
+	template <> struct TEncoderFor<FLinearColor, TSF_G8> { typedef TLinearToLuminance<uint8> Type; };
+	template <> struct TEncoderFor<FLinearColor, TSF_RGBA16> { typedef FLinearToRGBA16 Type; };
+	template <> struct TEncoderFor<FLinearColor, TSF_RGBA16F> { typedef FLinearToRGBA16F Type; };
+	template <> struct TEncoderFor<FLinearColor, TSF_RGBA8> { typedef FLinearToRGBA8 Type; };
+	template <> struct TEncoderFor<FLinearColor, TSF_RGBE8> { typedef TLinearToRGBE<false> Type; };
+
+	template <> struct TEncoderFor<FColor, TSF_BGRA8> { typedef FColorToBGRA8 Type; };
+	template <> struct TEncoderFor<FColor, TSF_BGRE8> { typedef TColorViaLinear<TLinearToRGBE<true>> Type; };
+	template <> struct TEncoderFor<FColor, TSF_G16> { typedef TColorViaLinear<TLinearToLuminance<uint16>> Type; };
+	template <> struct TEncoderFor<FColor, TSF_G8> { typedef TColorViaLinear<TLinearToLuminance<uint8>> Type; };
+	template <> struct TEncoderFor<FColor, TSF_RGBA16> { typedef TColorViaLinear<FLinearToRGBA16> Type; };
+	template <> struct TEncoderFor<FColor, TSF_RGBA16F> { typedef TColorViaLinear<FLinearToRGBA16F> Type; };
+	template <> struct TEncoderFor<FColor, TSF_RGBA8> { typedef FColorToRGBA8 Type; };
+	template <> struct TEncoderFor<FColor, TSF_RGBE8> { typedef TColorViaLinear<TLinearToRGBE<false>> Type; };
+
+	template <> struct TEncoderFor<FFloat16, TSF_G16> { typedef FHalfToG16 Type; };
+	template <> struct TEncoderFor<FFloat16Color, TSF_RGBA16F> { typedef TCopyPixel<FFloat16Color> Type; };
+
+	template <typename TSource, bool bSRGB, bool bVectorized> FTextureBakerTranscoder SelectTranscoder(ETextureSourceFormat ImageFormat)
+	{
+		switch (ImageFormat)
+		{
+		case TSF_BGRA8: return MakeTranscoder<typename TEncoderFor<TSource, TSF_BGRA8>::Type, bSRGB, bVectorized>();
+		case TSF_BGRE8: return MakeTranscoder<typename TEncoderFor<TSource, TSF_BGRE8>::Type, bSRGB, bVectorized>();
+		case TSF_G16: return MakeTranscoder<typename TEncoderFor<TSource, TSF_G16>::Type, bSRGB, bVectorized>();
+		case TSF_G8: return MakeTranscoder<typename TEncoderFor<TSource, TSF_G8>::Type, bSRGB, bVectorized>();
+		case TSF_RGBA16: return MakeTranscoder<typename TEncoderFor<TSource, TSF_RGBA16>::Type, bSRGB, bVectorized>();
+		case TSF_RGBA16F: return MakeTranscoder<typename TEncoderFor<TSource, TSF_RGBA16F>::Type, bSRGB, bVectorized>();
+		case TSF_RGBA8: return MakeTranscoder<typename TEncoderFor<TSource, TSF_RGBA8>::Type, bSRGB, bVectorized>();
+		case TSF_RGBE8: return MakeTranscoder<typename TEncoderFor<TSource, TSF_RGBE8>::Type, bSRGB, bVectorized>();
+		}
+		return FTextureBakerTranscoder();
+	}
+
+	// Resolves the specialized transcoder once per image, so pixel loops carry no format, sRGB or direction branches
+	template <typename TSource> FTextureBakerTranscoder GetTranscoder(ETextureSourceFormat ImageFormat, bool bSRGB, bool bVectorized)
+	{
+		bVectorized = bVectorized && TEXTUREBAKER_VECTOR_TRANSCODE;
+		if (bSRGB)
+		{
+			return bVectorized ? SelectTranscoder<TSource, true, true>(ImageFormat) : SelectTranscoder<TSource, true, false>(ImageFormat);
+		}
+		return bVectorized ? SelectTranscoder<TSource, false, true>(ImageFormat) : SelectTranscoder<TSource, false, false>(ImageFormat);
+	}
+}
@@ -0,0 +1,101 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "TextureBakerEncodePass.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace TextureBakerEncodeRangeTests
+{
+	static bool SameBits(float A, float B)
+	{
+		return FMemory::Memcmp(&A, &B, sizeof(float)) == 0;
+	}
+
+	static float FromBits(uint32 Bits)
+	{
+		float Value;
+		FMemory::Memcpy(&Value, &Bits, sizeof(float));
+		return Value;
+	}
+
+	// Reduces pixels into a zeroed range record and decodes it, as the range pass and its readback do
+	static void ReduceRange(const TArray<FLinearColor>& Pixels, FLinearColor& OutMin, FLinearColor& OutMax)
+	{
+		uint32 RangeWords[FTextureBakerEncodePass::RangeBufferSize / sizeof(uint32)] = {};
+		for (const FLinearColor& Pixel : Pixels)
+		{
+			FTextureBakerEncodePass::AccumulateRange(Pixel, RangeWords);
+		}
+		FTextureBakerEncodePass::DecodeRange(RangeWords, OutMin, OutMax);
+	}
+}
+
+// Range the GPU pass reduces has to be the range Auto normalization of the engine readback would use
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTextureBakerEncodeRangeTest, "TextureBaker.Readback.EncodedRange",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTextureBakerEncodeRangeTest::RunTest(const FString& Parameters)
+{
+	using namespace TextureBakerEncodeRangeTests;
+	const float Infinity = FromBits(0x7F800000u);
+	const float NaN = FromBits(0x7FC00000u);
+
+	// Sorted ascending, including signed zeros and denormals
+	const TArray<float> Values = {
+		-Infinity, -1.0e30f, -3.5f, -1.0f, -1.0e-20f, -FromBits(0x00000001u), -0.0f,
+		0.0f, FromBits(0x00000001u), FromBits(0x007FFFFFu), 1.0e-20f, 0.5f, 1.0f, 1.0e30f, Infinity
+	};
+
+	// A single value decodes to itself bit for bit, as minimum and as maximum
+	for (const float Value : Values)
+	{
+		FLinearColor Min, Max;
+		ReduceRange({ FLinearColor(Value, Value, Value, Value) }, Min, Max);
+		TestTrue(*FString::Printf(TEXT("Round trip of %g (0x%08x)"), Value, *reinterpret_cast<const uint32*>(&Value)),
+			SameBits(Min.R, Value) && SameBits(Max.R, Value) && SameBits(Min.A, Value) && SameBits(Max.A, Value));
+	}
+
+	// Encoding keeps the float order: every ordered pair reduces to its lower and upper value, in either order
+	for (int32 Lower = 0; Lower < Values.Num(); Lower++)
+	{
+		for (int32 Upper = Lower + 1; Upper < Values.Num(); Upper++)
+		{
+			const float A = Values[Lower];
+			const float B = Values[Upper];
+			FLinearColor Min, Max;
+			ReduceRange({ FLinearColor(A, B, A, B), FLinearColor(B, A, B, A) }, Min, Max);
+			TestTrue(*FString::Printf(TEXT("Order of %g and %g"), A, B),
+				SameBits(Min.R, A) && SameBits(Max.R, B) && SameBits(Min.G, A) && SameBits(Max.G, B));
+		}
+	}
+
+	// NaN doesn't take part in the range, a channel of NaNs only is left empty
+	{
+		FLinearColor Min, Max;
+		ReduceRange({ FLinearColor(NaN, -2.0f, 0.5f, NaN), FLinearColor(3.0f, NaN, 0.25f, NaN), FLinearColor(-1.0f, 4.0f, NaN, NaN) }, Min, Max);
+		TestTrue(TEXT("NaN is skipped by the minimum"), Min.R == -1.0f && Min.G == -2.0f && Min.B == 0.25f);
+		TestTrue(TEXT("NaN is skipped by the maximum"), Max.R == 3.0f && Max.G == 4.0f && Max.B == 0.5f);
+		TestTrue(TEXT("Channel of NaNs is empty"), Min.A == Infinity && Max.A == -Infinity);
+
+		float RangeMin, RangeMax;
+		FTextureBakerEncodePass::GetNormalizationRange(Min, Max, RangeMin, RangeMax);
+		TestTrue(TEXT("Empty channel doesn't affect normalization"), RangeMin == -2.0f && RangeMax == 4.0f);
+	}
+
+	// Normalization range is taken over all channels and always covers [0, 1]
+	{
+		float RangeMin, RangeMax;
+		FTextureBakerEncodePass::GetNormalizationRange(FLinearColor(0.25f, 0.5f, 0.25f, 1.0f), FLinearColor(0.75f, 0.5f, 0.5f, 1.0f), RangeMin, RangeMax);
+		TestTrue(TEXT("In range image is extended to [0, 1]"), RangeMin == 0.0f && RangeMax == 1.0f);
+
+		FTextureBakerEncodePass::GetNormalizationRange(FLinearColor(-1.0f, 0.0f, 0.5f, 0.0f), FLinearColor(3.0f, 2.0f, 0.5f, 1.0f), RangeMin, RangeMax);
+		TestTrue(TEXT("Out of range channels widen the range"), RangeMin == -1.0f && RangeMax == 3.0f);
+
+		FTextureBakerEncodePass::GetNormalizationRange(FLinearColor(0.5f, 0.5f, 0.5f, 0.5f), FLinearColor(0.5f, 2.0f, 0.5f, 0.5f), RangeMin, RangeMax);
+		TestTrue(TEXT("Range above 1 keeps 0 as its minimum"), RangeMin == 0.0f && RangeMax == 2.0f);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,111 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "TextureBaker.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace TextureBakerNativeReadbackTests
+{
+	// Feeds a staging surface whose rows are padded to RowPitch pixels to the handler, returns its readback buffer
+	template <typename T> static TArray64<uint8> ReadStaging(const FTextureBakerSurfaceReadback& Handler, EPixelFormat SurfaceFormat, const FIntPoint& Size, int32 RowPitch, const TArray<T>& Pixels)
+	{
+		TArray<T> Surface;
+		Surface.SetNumZeroed(RowPitch * Size.Y);
+		for (int32 Row = 0; Row < Size.Y; Row++)
+		{
+			FMemory::Memcpy(&Surface[Row * RowPitch], &Pixels[Row * Size.X], Size.X * sizeof(T));
+		}
+		TArray64<uint8> Readback;
+		Readback.SetNumZeroed(Handler.GetRequiredReadbackBufferSize(Size));
+		Handler.ReadbackStagingSurface(Surface.GetData(), RowPitch, SurfaceFormat, Size, Readback.GetData());
+		return Readback;
+	}
+}
+
+// Native surface handlers have to give the values the engine readback gave for the same surface and range mapping
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTextureBakerNativeReadbackTest, "TextureBaker.Readback.NativeSurfaces",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTextureBakerNativeReadbackTest::RunTest(const FString& Parameters)
+{
+	using namespace TextureBakerNativeReadbackTests;
+	const FIntPoint Size(3, 2);
+	const int32 RowPitch = 5;
+
+	// In range float pixels come out as they are with either range mapping
+	const TArray<FLinearColor> InRange = {
+		FLinearColor(0.0f, 0.25f, 0.5f, 1.0f), FLinearColor(1.0f, 0.75f, 0.125f, 0.5f), FLinearColor(0.5f, 0.5f, 0.5f, 0.5f),
+		FLinearColor(0.0625f, 0.0f, 1.0f, 0.0f), FLinearColor(0.375f, 0.625f, 0.875f, 1.0f), FLinearColor(1.0f, 1.0f, 1.0f, 1.0f)
+	};
+	// Out of range channels are rescaled by their own min/max, extended to [0, 1]: R spans [-1, 3], G [0, 2], B and A stay in range
+	const TArray<FLinearColor> OutOfRange = {
+		FLinearColor(-1.0f, 0.0f, 0.5f, 1.0f), FLinearColor(3.0f, 2.0f, 0.25f, 0.5f), FLinearColor(1.0f, 1.0f, 0.0f, 0.0f),
+		FLinearColor(0.0f, 0.5f, 1.0f, 1.0f), FLinearColor(-1.0f, 1.5f, 0.5f, 0.25f), FLinearColor(3.0f, 0.0f, 0.75f, 0.75f)
+	};
+	TArray<FLinearColor> OutOfRangeSaturated;
+	for (const FLinearColor& Pixel : OutOfRange)
+	{
+		OutOfRangeSaturated.Add(FLinearColor((Pixel.R + 1.0f) / 4.0f, Pixel.G / 2.0f, Pixel.B, Pixel.A));
+	}
+
+	for (const ETBImageNormalization Normalization : { ETBImageNormalization::Saturate, ETBImageNormalization::Normalize })
+	{
+		const bool bSaturate = (Normalization == ETBImageNormalization::Saturate);
+		const TCHAR* ModeName = bSaturate ? TEXT("Saturate") : TEXT("Normalize");
+
+		TSharedPtr<FTextureBakerSurfaceReadback> Handler32 = FTextureBakerModule::GetReadbackHandler(ETextureSourceFormat::TSF_RGBA16F, ETextureRenderTargetFormat::RTF_RGBA32f, false, Normalization);
+		TSharedPtr<FTextureBakerSurfaceReadback> Handler16 = FTextureBakerModule::GetReadbackHandler(ETextureSourceFormat::TSF_RGBA16F, ETextureRenderTargetFormat::RTF_RGBA16f, false, Normalization);
+		if (!TestTrue(*FString::Printf(TEXT("%s: float handlers read staging surfaces"), ModeName), Handler32.IsValid() && Handler16.IsValid()
+			&& Handler32->SupportsStagingReadback(PF_A32B32G32R32F) && Handler16->SupportsStagingReadback(PF_FloatRGBA)))
+		{
+			continue;
+		}
+
+		for (const bool bOutOfRange : { false, true })
+		{
+			const TArray<FLinearColor>& Pixels = bOutOfRange ? OutOfRange : InRange;
+			const TArray<FLinearColor>& Expected = (bOutOfRange && bSaturate) ? OutOfRangeSaturated : Pixels;
+
+			TArray64<uint8> Readback32 = ReadStaging(*Handler32, PF_A32B32G32R32F, Size, RowPitch, Pixels);
+			TArray64<uint8> Expected32(reinterpret_cast<const uint8*>(Expected.GetData()), Expected.Num() * sizeof(FLinearColor));
+			TestTrue(*FString::Printf(TEXT("%s: RGBA32f %s pixels"), ModeName, bOutOfRange ? TEXT("out of range") : TEXT("in range")), Readback32 == Expected32);
+
+			TArray<FFloat16Color> HalfPixels;
+			TArray<FFloat16Color> HalfExpected;
+			for (int32 Index = 0; Index < Pixels.Num(); Index++)
+			{
+				HalfPixels.Add(FFloat16Color(Pixels[Index]));
+				HalfExpected.Add(FFloat16Color(Expected[Index]));
+			}
+			TArray64<uint8> Readback16 = ReadStaging(*Handler16, PF_FloatRGBA, Size, RowPitch, HalfPixels);
+			TArray64<uint8> Expected16(reinterpret_cast<const uint8*>(HalfExpected.GetData()), HalfExpected.Num() * sizeof(FFloat16Color));
+			TestTrue(*FString::Printf(TEXT("%s: RGBA16f %s pixels"), ModeName, bOutOfRange ? TEXT("out of range") : TEXT("in range")), Readback16 == Expected16);
+		}
+	}
+
+	// Unorm surfaces are copied row by row, without the row padding
+	const TArray<uint8> R8Pixels = { 0, 1, 127, 128, 254, 255 };
+	for (const ETBImageNormalization Normalization : { ETBImageNormalization::Saturate, ETBImageNormalization::Normalize })
+	{
+		TSharedPtr<FTextureBakerSurfaceReadback> HandlerR8 = FTextureBakerModule::GetReadbackHandler(ETextureSourceFormat::TSF_G8, ETextureRenderTargetFormat::RTF_R8, false, Normalization);
+		if (TestTrue(TEXT("R8 handler reads staging surfaces"), HandlerR8.IsValid() && HandlerR8->SupportsStagingReadback(PF_G8)))
+		{
+			TArray64<uint8> ReadbackR8 = ReadStaging(*HandlerR8, PF_G8, Size, RowPitch, R8Pixels);
+			TestTrue(TEXT("R8 pixels are copied as they are"), ReadbackR8 == TArray64<uint8>(R8Pixels.GetData(), R8Pixels.Num()));
+		}
+	}
+
+	// Saturated R16f surfaces keep the engine conversion, Normalize reads them natively
+	TSharedPtr<FTextureBakerSurfaceReadback> SaturatedR16 = FTextureBakerModule::GetReadbackHandler(ETextureSourceFormat::TSF_G16, ETextureRenderTargetFormat::RTF_R16f, false, ETBImageNormalization::Saturate);
+	TestTrue(TEXT("Saturated R16f surfaces aren't read natively"), SaturatedR16.IsValid() && !SaturatedR16->SupportsStagingReadback(PF_R16F));
+	TSharedPtr<FTextureBakerSurfaceReadback> NormalizedR16 = FTextureBakerModule::GetReadbackHandler(ETextureSourceFormat::TSF_G16, ETextureRenderTargetFormat::RTF_R16f, false, ETBImageNormalization::Normalize);
+	if (TestTrue(TEXT("Normalized R16f surfaces are read natively"), NormalizedR16.IsValid() && NormalizedR16->SupportsStagingReadback(PF_R16F)))
+	{
+		const TArray<FFloat16> HalfPixels = { FFloat16(-2.0f), FFloat16(0.0f), FFloat16(0.5f), FFloat16(1.0f), FFloat16(4.0f), FFloat16(0.25f) };
+		TArray64<uint8> ReadbackR16 = ReadStaging(*NormalizedR16, PF_R16F, Size, RowPitch, HalfPixels);
+		TestTrue(TEXT("Normalized R16f pixels keep raw values"), ReadbackR16 == TArray64<uint8>(reinterpret_cast<const uint8*>(HalfPixels.GetData()), HalfPixels.Num() * sizeof(FFloat16)));
+	}
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
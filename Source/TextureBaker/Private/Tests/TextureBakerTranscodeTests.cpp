@@ -0,0 +1,116 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "TextureBaker.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// In-place transcoding has to produce the same image as transcoding into a separate buffer. Only pairs where the image pixel is larger
+// than the readback pixel are covered, those walk backward over their own input. Runs without a GPU, readback data is synthetic
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTextureBakerInPlaceTranscodeTest, "TextureBaker.Transcode.InPlaceGrowing",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTextureBakerInPlaceTranscodeTest::RunTest(const FString& Parameters)
+{
+	const ETextureRenderTargetFormat SurfaceFormats[] = {
+		ETextureRenderTargetFormat::RTF_R8, ETextureRenderTargetFormat::RTF_RG8, ETextureRenderTargetFormat::RTF_RGBA8, ETextureRenderTargetFormat::RTF_RGBA8_SRGB,
+		ETextureRenderTargetFormat::RTF_R16f, ETextureRenderTargetFormat::RTF_RGBA16f, ETextureRenderTargetFormat::RTF_RGBA32f
+	};
+	const ETextureSourceFormat ImageFormats[] = {
+		ETextureSourceFormat::TSF_G8, ETextureSourceFormat::TSF_BGRA8, ETextureSourceFormat::TSF_BGRE8, ETextureSourceFormat::TSF_RGBA16,
+		ETextureSourceFormat::TSF_RGBA16F, ETextureSourceFormat::TSF_RGBA8, ETextureSourceFormat::TSF_RGBE8, ETextureSourceFormat::TSF_G16
+	};
+	const ETBImageNormalization Normalizations[] = { ETBImageNormalization::Saturate, ETBImageNormalization::Normalize, ETBImageNormalization::Auto };
+	// Odd counts leave scalar tails next to the vector groups
+	const int32 PixelCounts[] = { 1, 3, 4, 5, 257, 4099 };
+
+	IConsoleVariable* VectorizedVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("TextureBaker.Transcode.Vectorized"));
+	const int32 PreviousVectorized = VectorizedVariable ? VectorizedVariable->GetInt() : 1;
+	UEnum* SurfaceFormatEnum = StaticEnum<ETextureRenderTargetFormat>();
+	UEnum* ImageFormatEnum = StaticEnum<ETextureSourceFormat>();
+	int32 NumPairs = 0;
+
+	for (const int32 Vectorized : { 0, 1 })
+	{
+		if (VectorizedVariable)
+		{
+			VectorizedVariable->Set(Vectorized, ECVF_SetByCode);
+		}
+		for (ETextureRenderTargetFormat SurfaceFormat : SurfaceFormats)
+		{
+			const bool bUnormSurface = (SurfaceFormat == ETextureRenderTargetFormat::RTF_R8 || SurfaceFormat == ETextureRenderTargetFormat::RTF_RG8
+				|| SurfaceFormat == ETextureRenderTargetFormat::RTF_RGBA8 || SurfaceFormat == ETextureRenderTargetFormat::RTF_RGBA8_SRGB);
+			const bool bSRGB = (SurfaceFormat == ETextureRenderTargetFormat::RTF_RGBA8_SRGB);
+			for (ETextureSourceFormat ImageFormat : ImageFormats)
+			{
+				for (ETBImageNormalization Normalization : Normalizations)
+				{
+					// Handlers bind their transcoder on creation, so they're created after the vectorization switch
+					TSharedPtr<FTextureBakerSurfaceReadback> Handler = FTextureBakerModule::GetReadbackHandler(ImageFormat, SurfaceFormat, bSRGB, Normalization);
+					const uint64 ReadbackPixelBytes = Handler.IsValid() ? Handler->GetRequiredReadbackBufferSize(FIntPoint(1, 1)) : 0;
+					const uint64 ImagePixelBytes = FTextureSource::GetBytesPerPixel(ImageFormat);
+					if (!Handler.IsValid() || Handler->DirectlyCompatibleWithImage(ImageFormat) || ImagePixelBytes <= ReadbackPixelBytes)
+					{
+						continue;
+					}
+
+					const FString PairName = FString::Printf(TEXT("%s -> %s, %s, vectorized %d"), *SurfaceFormatEnum->GetNameStringByValue(int64(SurfaceFormat)),
+						*ImageFormatEnum->GetNameStringByValue(int64(ImageFormat)), *StaticEnum<ETBImageNormalization>()->GetNameStringByValue(int64(Normalization)), Vectorized);
+					NumPairs++;
+					for (const int32 PixelNum : PixelCounts)
+					{
+						const FIntPoint Size(PixelNum, 1);
+						const uint64 ReadbackBytes = Handler->GetRequiredReadbackBufferSize(Size);
+						const uint64 ImageBytes = ImagePixelBytes * PixelNum;
+						const uint64 InPlaceBytes = Handler->GetRequiredReadbackBufferSize(Size, ImageFormat);
+
+						// Float readbacks are kept finite, NaN payloads aren't something a surface hands back
+						TArray64<uint8> Readback;
+						Readback.SetNumUninitialized(ReadbackBytes);
+						FRandomStream Random(PixelNum * 31 + int32(ImageFormat));
+						for (uint8& Byte : Readback)
+						{
+							Byte = uint8(bUnormSurface ? Random.RandRange(0, 255) : Random.RandRange(0, 0x3B));
+						}
+
+						TArray64<uint8> Expected;
+						Expected.SetNumZeroed(ImageBytes);
+						if (Handler->TranscodeToImageFormat(ImageFormat, Expected.GetData(), Readback.GetData(), PixelNum, ImageBytes) == nullptr)
+						{
+							AddError(FString::Printf(TEXT("%s: no transcoder"), *PairName));
+							break;
+						}
+
+						// Bytes past the readback are garbage in a real image buffer as well
+						TArray64<uint8> InPlace;
+						InPlace.Init(0xCD, FMath::Max(InPlaceBytes, ReadbackBytes));
+						FMemory::Memcpy(InPlace.GetData(), Readback.GetData(), ReadbackBytes);
+						const void* Result = Handler->TranscodeToImageFormat(ImageFormat, InPlace.GetData(), nullptr, PixelNum, InPlace.Num());
+						if (!TestTrue(*FString::Printf(TEXT("%s: in-place transcoding of %d pixels is supported"), *PairName, PixelNum), Result == InPlace.GetData()))
+						{
+							continue;
+						}
+						for (uint64 ByteIndex = 0; ByteIndex < ImageBytes; ByteIndex++)
+						{
+							if (InPlace[ByteIndex] != Expected[ByteIndex])
+							{
+								AddError(FString::Printf(TEXT("%s: in-place transcoding of %d pixels differs at pixel %llu"), *PairName, PixelNum, ByteIndex / ImagePixelBytes));
+								break;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	if (VectorizedVariable)
+	{
+		VectorizedVariable->Set(PreviousVectorized, ECVF_SetByCode);
+	}
+	TestTrue(TEXT("Growing format pairs were found"), NumPairs > 0);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -15,19 +15,48 @@
 #include "PackageTools.h"
 #include "ObjectTools.h"
 #include "AssetRegistryModule.h"
-#include "Interfaces/IPluginManager.h"
 #include "EngineLogs.h"
+#include "HAL/IConsoleManager.h"
+#include "Async/ParallelFor.h"
+#include "Renderer/TextureBakerTranscoders.h"
+#include "RHIGPUReadback.h"
+#include "RenderingThread.h"
+#include "Misc/SecureHash.h"
+#include "UObject/MetaData.h"
+#include "Renderer/TextureBakerMips.h"
+#include "TextureBakerCompression.h"
+#include "TextureBakerSaveQueue.h"
+#include "TextureBakerImageExport.h"
+#include "TextureBakerSourceCompression.h"
 
 static const FName TextureBakerTabName("TextureBaker");
 
+static TAutoConsoleVariable<int32> CVarTextureBakerVectorTranscode(
+	TEXT("TextureBaker.Transcode.Vectorized"),
+	1,
+	TEXT("Transcode readback data with vector kernels.\n")
+	TEXT(" 0: scalar reference path\n")
+	TEXT(" 1: vector kernels where the platform supports them (default)"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTextureBakerTranscodeBandSize(
+	TEXT("TextureBaker.Transcode.BandSizeKB"),
+	256,
+	TEXT("Amount of readback data (in KB) transcoded by a single parallel task. Bands are rounded to whole image rows."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTextureBakerTranscodeParallelMinPixels(
+	TEXT("TextureBaker.Transcode.ParallelMinPixels"),
+	256 * 256,
+	TEXT("Images with fewer pixels are transcoded on the calling thread. 0 disables parallel transcoding."),
+	ECVF_Default);
+
 #define LOCTEXT_NAMESPACE "FTextureBakerModule"
 
 void FTextureBakerModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
-	FString PluginShaderDir = FPaths::Combine(IPluginManager::Get().FindPlugin(TEXT("TextureBaker"))->GetBaseDir(), TEXT("Shaders"));
-	AddShaderSourceDirectoryMapping(TEXT("/Plugin/TextureBaker"), PluginShaderDir);
-
+	// Shader directory is mapped by TextureBakerShaders module, which is loaded early enough for global shaders
 	FTextureBakerStyle::Initialize();
 	FTextureBakerStyle::ReloadTextures();
 
@@ -61,6 +90,18 @@ void FTextureBakerModule::ShutdownModule()
 	FTextureBakerCommands::Unregister();
 
 	FGlobalTabmanager::Get()->UnregisterNomadTabSpawner(TextureBakerTabName);
+
+	ResourceCache.Reset();
+}
+
+TSharedRef<FTextureBakerResourceCache> FTextureBakerModule::GetResourceCache()
+{
+	check(IsInGameThread());
+	if (!ResourceCache.IsValid())
+	{
+		ResourceCache = MakeShared<FTextureBakerResourceCache>();
+	}
+	return ResourceCache.ToSharedRef();
 }
 
 TSharedRef<SDockTab> FTextureBakerModule::OnSpawnPluginTab(const FSpawnTabArgs& SpawnTabArgs)
@@ -110,33 +151,161 @@ void FTextureBakerModule::RegisterMenus()
 
 void FTextureBakerModule::ExecuteBakerRenderContext(TUniquePtr<FTextureBakerRenderContext> Context)
 {
-	FScopedSlowTask Feedback(Context->GetOutputsToBake().Num() + 1, NSLOCTEXT("TextureBaker", "TextureBaker_BakeTexture", "Bake requested textures..."));
+	FScopedSlowTask Feedback(Context->GetOutputsToBake().Num() + 2, NSLOCTEXT("TextureBaker", "TextureBaker_BakeTexture", "Bake requested textures..."));
 	Feedback.MakeDialog(true);
 
-	/* Prepare for baking */
+	/* Prepare for baking. Pools are shared with earlier bakes, only their counters start over */
+	Context->GetResourceCache().ResetStats();
 	{
 		Feedback.EnterProgressFrame();
 		Context->PrepareToBakeOutputs();
 	}
 
-	/* Bake each output */
+	/* Bake each output. Readback of an output is overlapped with rendering of the next ones, it's saved once the in-flight queue is full */
+	const int32 MaxResultsInFlight = Context->GetMaxReadbacksInFlight();
+	TArray<FTextureBakerRenderResult> ResultsInFlight;
+	TUniquePtr<FTextureBakerCompressionQueue> CompressionQueue = FTextureBakerCompressionQueue::IsEnabled() ? MakeUnique<FTextureBakerCompressionQueue>() : nullptr;
+	TUniquePtr<FTextureBakerSaveQueue> SaveQueue = FTextureBakerSaveQueue::IsEnabled() ? MakeUnique<FTextureBakerSaveQueue>(CompressionQueue.Get()) : nullptr;
+	FTextureBakerImageExporter Exporter;
+	int32 NumWritten = 0;
+	int32 NumUnchanged = 0;
+	int32 NumExported = 0;
+	auto SaveResult = [&](const FTextureBakerRenderResult& Result)
+	{
+		if (Result.GetInfo().Destination == ETBOutputDestination::ImageFile)
+		{
+			NumExported += ExportBakedImageResult(Result, Exporter, Context->GetReadbackArena()) ? 1 : 0;
+			return;
+		}
+		const ETBSaveResult Outcome = SaveBakedTextureResult(Result, true, Context->GetReadbackArena(), CompressionQueue.Get(), SaveQueue.Get());
+		NumWritten += (Outcome == ETBSaveResult::Written) ? 1 : 0;
+		NumUnchanged += (Outcome == ETBSaveResult::Unchanged) ? 1 : 0;
+	};
+	// Image of a saved output is on the host already, its render target goes back to the pool for the next outputs
+	auto SaveAndReleaseResult = [&](const FTextureBakerRenderResult& Result)
+	{
+		SaveResult(Result);
+		Context->ReleaseObject(Result.GetTextureRenderTarget());
+	};
 	for (const FName& OutputName : Context->GetOutputsToBake())
 	{
 		Context->EnterRenderScope();
 		Feedback.EnterProgressFrame();
-		const FTextureBakerRenderResult& Result = Context->BakeOutput(OutputName);
-		if (Result.IsValid())
+		FTextureBakerRenderResult Result = Context->BakeOutput(OutputName);
+		if (Result.IsValid() && Result.IsTiled())
+		{
+			// Tiles are rendered while the output is saved, in its own render scope
+			SaveResult(Result);
+		}
+		else if (Result.IsValid())
+		{
+			ResultsInFlight.Add(Result);
+		}
+		while (ResultsInFlight.Num() >= MaxResultsInFlight)
 		{
-			SaveBakedTextureResult(Result, true);
+			SaveAndReleaseResult(ResultsInFlight[0]);
+			ResultsInFlight.RemoveAt(0);
 		}
 		Context->ExitRenderScope();
+		if (CompressionQueue)
+		{
+			CompressionQueue->Tick();
+		}
+	}
+
+	for (const FTextureBakerRenderResult& Result : ResultsInFlight)
+	{
+		SaveAndReleaseResult(Result);
+	}
+
+	/* Save the last batch and wait for outputs still compressing on worker threads */
+	Feedback.EnterProgressFrame(1.0f, NSLOCTEXT("TextureBaker", "TextureBaker_CompressTextures", "Compressing baked textures..."));
+	if (SaveQueue)
+	{
+		SaveQueue->Finish();
+	}
+	if (CompressionQueue)
+	{
+		CompressionQueue->Finish();
+	}
+	NumExported -= Exporter.Finish();
+
+	const FTextureBakerReadbackArena* ReadbackArena = Context->GetReadbackArena();
+	UE_LOG(LogTexture, Log, TEXT("Texture bake finished, %d outputs written, %d unchanged outputs skipped, %d outputs exported to image files"), NumWritten, NumUnchanged, NumExported);
+	UE_LOG(LogTexture, Log, TEXT("Texture bake finished, readback arena peak %.1f MB, %d allocations, %d reuses"),
+		ReadbackArena->GetPeakBytes() / (1024.0 * 1024.0), ReadbackArena->GetNumAllocations(), ReadbackArena->GetNumReuses());
+	const FTextureBakerResourceCache& ResourceCache = Context->GetResourceCache();
+	const FTextureBakerRenderTargetPool& RenderTargetPool = ResourceCache.GetRenderTargetPool();
+	UE_LOG(LogTexture, Log, TEXT("Texture bake finished, render target pool %d hits, %d misses, %d render targets created, %d evicted, peak %.1f MB"),
+		RenderTargetPool.GetNumHits(), RenderTargetPool.GetNumMisses(), RenderTargetPool.GetNumCreated(), RenderTargetPool.GetNumEvicted(), RenderTargetPool.GetPeakBytes() / (1024.0 * 1024.0));
+	for (const TPair<ETextureRenderTargetFormat, FTextureBakerRenderTargetOccupancy>& FormatOccupancy : RenderTargetPool.GetOccupancy())
+	{
+		UE_LOG(LogTexture, Log, TEXT("  %s: %d in use (%.1f MB), %d free (%.1f MB)"), *StaticEnum<ETextureRenderTargetFormat>()->GetNameStringByValue(int64(FormatOccupancy.Key)),
+			FormatOccupancy.Value.NumInUse, FormatOccupancy.Value.InUseBytes / (1024.0 * 1024.0), FormatOccupancy.Value.NumFree, FormatOccupancy.Value.FreeBytes / (1024.0 * 1024.0));
+	}
+	int64 TransientUnaliasedBytes = 0;
+	int64 TransientAliasedBytes = 0;
+	Context->GetTransientPeakBytes(TransientUnaliasedBytes, TransientAliasedBytes);
+	UE_LOG(LogTexture, Log, TEXT("Texture bake finished, transient render targets peak %.1f MB without aliasing, %.1f MB with aliasing, render target pool peak %.1f MB"),
+		TransientUnaliasedBytes / (1024.0 * 1024.0), TransientAliasedBytes / (1024.0 * 1024.0), RenderTargetPool.GetPeakBytes() / (1024.0 * 1024.0));
+	UE_LOG(LogTexture, Log, TEXT("Texture bake finished, %d derived art textures pooled (%.1f MB)"), ResourceCache.GetNumDerivedArt(), ResourceCache.GetDerivedArtBytes() / (1024.0 * 1024.0));
+	const FTextureBakerDerivedArtCache& DerivedArtCache = ResourceCache.GetDerivedArtCache();
+	UE_LOG(LogTexture, Log, TEXT("Texture bake finished, derived art cache %d hits, %d misses, %d files evicted, %.1f MB on disk"),
+		DerivedArtCache.GetNumHits(), DerivedArtCache.GetNumMisses(), DerivedArtCache.GetNumEvicted(), DerivedArtCache.GetCachedBytes() / (1024.0 * 1024.0));
+}
+
+static const TCHAR* TextureBakerOutputHashKey = TEXT("TextureBakerOutputHash");
+
+// Hash of everything that ends up in the saved texture: image data as written to the source and output attributes
+static FString ComputeOutputHash(const FTextureBakerOutputInfo& Info, const FIntPoint& Size, ETextureSourceFormat Format, bool bSRGB, const void* ImageData, uint64 ImageBytes)
+{
+	FString AttributesText;
+	FTextureBakerOutputInfo::StaticStruct()->ExportText(AttributesText, &Info, nullptr, nullptr, PPF_None, nullptr);
+	const FString HeaderText = FString::Printf(TEXT("v1 %dx%d %d %d "), Size.X, Size.Y, int32(Format), bSRGB ? 1 : 0) + AttributesText;
+	const FTCHARToUTF8 HeaderUTF8(*HeaderText);
+
+	FSHA1 Hasher;
+	Hasher.Update(reinterpret_cast<const uint8*>(HeaderUTF8.Get()), HeaderUTF8.Length());
+	Hasher.Update(static_cast<const uint8*>(ImageData), ImageBytes);
+	Hasher.Final();
+	FSHAHash Hash;
+	Hasher.GetHash(Hash.Hash);
+	return Hash.ToString();
+}
+
+// Undoes a save that failed after the texture was touched. A texture created for the output is discarded, an existing one is reloaded
+// from its package file, so a half written source isn't persisted by a later save. The texture pointer is stale afterwards
+static void DiscardFailedOutput(UTexture2D* Texture, bool bCreatedTexture)
+{
+	UPackage* Package = Texture->GetOutermost();
+	if (bCreatedTexture)
+	{
+		Texture->ClearFlags(RF_Public | RF_Standalone);
+		Texture->Rename(nullptr, GetTransientPackage(), REN_DontCreateRedirectors | REN_NonTransactional | REN_ForceNoResetLoaders);
+		Texture->MarkPendingKill();
+	}
+	else if (FPackageName::DoesPackageExist(Package->GetName()))
+	{
+		FText ErrorMessage;
+		if (!UPackageTools::ReloadPackages({ Package }, ErrorMessage, EReloadPackagesInteractionMode::AssumePositive))
+		{
+			UE_LOG(LogTexture, Error, TEXT("Couldn't reload %s after a failed bake: %s"), *Package->GetName(), *ErrorMessage.ToString());
+		}
+	}
+	else
+	{
+		// Never saved, there's nothing to restore the source from
+		UE_LOG(LogTexture, Warning, TEXT("Source of %s is dropped, it was partially overwritten by a failed bake"), *Texture->GetName());
+		Texture->Source.RemoveSourceData();
 	}
 }
 
-void FTextureBakerModule::SaveBakedTextureResult(const FTextureBakerRenderResult& Result, bool bOverrideExistingFiles)
+ETBSaveResult FTextureBakerModule::SaveBakedTextureResult(const FTextureBakerRenderResult& Result, bool bOverrideExistingFiles, FTextureBakerReadbackArena* ReadbackArena, FTextureBakerCompressionQueue* CompressionQueue, FTextureBakerSaveQueue* SaveQueue)
 {
 	if (Result.IsValid())
 	{
+		const double StartTime = FPlatformTime::Seconds();
+		const bool bDeferTextureBuild = SaveQueue ? (SaveQueue->GetCompressionQueue() != nullptr) : (CompressionQueue != nullptr);
 		FString AssetLongPackageName = Result.GetPackagePath();
 		FPaths::RemoveDuplicateSlashes(AssetLongPackageName);
 		const FString PackagePath = FPackageName::GetLongPackagePath(AssetLongPackageName);
@@ -151,31 +320,189 @@ void FTextureBakerModule::SaveBakedTextureResult(const FTextureBakerRenderResult
 
 		UPackage* PackageToSaveTexture = UPackageTools::FindOrCreatePackageForAssetType(*AssetLongPackageName, UTexture2D::StaticClass());
 		UTextureRenderTarget2D* RenderTarget = Result.GetTextureRenderTarget();
+		TSharedPtr<FTextureBakerTiledImage> TiledImage = Result.GetTiledImage();
 
-		if (PackageToSaveTexture && RenderTarget)
+		if (PackageToSaveTexture && (RenderTarget || Result.IsTiled()))
 		{
 			PackageToSaveTexture->FullyLoad();
 			UTexture2D* Texture = FindObject<UTexture2D>(PackageToSaveTexture, *BaseAssetName, true);
-			if (Texture == nullptr)
+
+			const ETextureSourceFormat ImageFormat = TiledImage ? TiledImage->Format : Result.GetInfo().OutputImageFormat;
+			const FIntPoint ImageSize = TiledImage ? TiledImage->Size : FIntPoint(RenderTarget->SizeX, RenderTarget->SizeY);
+			const uint64 ImageBytes = uint64(FTextureSource::GetBytesPerPixel(ImageFormat)) * ImageSize.X * ImageSize.Y;
+			const FTextureBakerSourceMipSettings MipSettings = Result.GetInfo().GetSourceMipSettings();
+			const int32 NumSourceMips = MipSettings.bGenerateMips ? TextureBakerMips::GetNumMips(ImageSize) : 1;
+
+			// Image is read straight into the source, tiles of tiled outputs too. An existing source of the same layout is overwritten in place,
+			// so an unchanged output rewrites the very same bytes and keeps the mips filtered from them
+			const bool bCreatedTexture = (Texture == nullptr);
+			if (bCreatedTexture)
 			{
-				Texture = NewObject<UTexture2D>(PackageToSaveTexture, *BaseAssetName, RenderTarget->GetMaskedFlags() | RF_Public | RF_Standalone);
+				Texture = NewObject<UTexture2D>(PackageToSaveTexture, *BaseAssetName, (RenderTarget ? RenderTarget->GetMaskedFlags() : RF_NoFlags) | RF_Public | RF_Standalone);
 			}
-
 			check(Texture);
+			FTextureSource& Source = Texture->Source;
+			const bool bSameSourceLayout = !bCreatedTexture && Source.IsValid() && Source.GetSizeX() == ImageSize.X && Source.GetSizeY() == ImageSize.Y
+				&& Source.GetNumSlices() == 1 && Source.GetNumMips() == NumSourceMips && Source.GetFormat() == ImageFormat;
+			const FGuid PreviousSourceId = Source.GetId();
+			const bool bPreviousSourceCompressed = bSameSourceLayout && Source.IsPNGCompressed();
+
+			// An existing source that can't be read is left as is. One that's replaced is restored if anything fails from here on
+			if (!bSameSourceLayout)
+			{
+				Source.Init(ImageSize.X, ImageSize.Y, 1, NumSourceMips, ImageFormat);
+			}
+			void* ImageBuffer = Source.LockMip(0);
+			if (!ImageBuffer)
+			{
+				if (!bSameSourceLayout)
+				{
+					DiscardFailedOutput(Texture, bCreatedTexture);
+				}
+				UE_LOG(LogTexture, Error, TEXT("Source of %s couldn't be locked, output isn't saved"), *BaseAssetName);
+				return ETBSaveResult::Failed;
+			}
+			if (TiledImage)
+			{
+				TiledImage->SetExternalData(ImageBuffer);
+				const bool bTilesRendered = Result.RenderTiles();
+				TiledImage->SetExternalData(nullptr);
+				if (!bTilesRendered)
+				{
+					Source.UnlockMip(0);
+					DiscardFailedOutput(Texture, bCreatedTexture);
+					UE_LOG(LogTexture, Error, TEXT("Tiles of %s couldn't be rendered, its source is incomplete and isn't saved"), *BaseAssetName);
+					return ETBSaveResult::Failed;
+				}
+			}
+			else
+			{
+				ReadRenderTargetImage(ImageFormat, RenderTarget, Result.GetInfo().Normalization, Result.GetPendingReadback(), ImageBuffer, ReadbackArena);
+			}
+			const bool bSRGB = TiledImage ? TiledImage->bSRGB : RenderTarget->IsSRGB();
+
+			UMetaData* MetaData = PackageToSaveTexture->GetMetaData();
+			const FString OutputHash = ComputeOutputHash(Result.GetInfo(), ImageSize, ImageFormat, bSRGB, ImageBuffer, ImageBytes);
+			if (bSameSourceLayout && MetaData->HasValue(Texture, TextureBakerOutputHashKey) && MetaData->GetValue(Texture, TextureBakerOutputHashKey) == OutputHash)
+			{
+				// Same bytes went back in, the source keeps its id so the built platform data stays valid. Locking decompressed
+				// a PNG source, it's compressed again so a later save of the package keeps it compressed
+				TFuture<TArray64<uint8>> RecompressedSource;
+				if (bPreviousSourceCompressed)
+				{
+					RecompressedSource = TextureBakerSourceCompression::BeginCompress(Source, ImageBuffer);
+				}
+				Source.UnlockMip(0);
+				Source.SetId(PreviousSourceId, false);
+				if (RecompressedSource.IsValid())
+				{
+					TextureBakerSourceCompression::ApplyCompressed(Texture, RecompressedSource);
+				}
+				UE_LOG(LogTexture, Log, TEXT("Baked %s is unchanged, skipping save"), *BaseAssetName);
+				return ETBSaveResult::Unchanged;
+			}
+
+			// Raw source is kept until the package is saved, so the texture can be built meanwhile
+			TFuture<TArray64<uint8>> CompressedSource;
+			if (Result.GetInfo().bCompressSourceArt)
+			{
+				if (TextureBakerSourceCompression::CanCompress(Source))
+				{
+					CompressedSource = TextureBakerSourceCompression::BeginCompress(Source, ImageBuffer);
+				}
+				else
+				{
+					UE_LOG(LogTexture, Log, TEXT("Source of %s can't be stored compressed, it has mips or an HDR format"), *BaseAssetName);
+				}
+			}
+			Source.UnlockMip(0);
+
 			Result.GetInfo().SetTextureAttributes(Texture);
-			WriteTexture2DSourceArt(Texture, Result.GetInfo().OutputImageFormat, RenderTarget, Result.GetInfo().Normalization);
+			FinishTexture2DSourceArt(Texture, bSRGB, MipSettings, !bDeferTextureBuild);
+			MetaData->SetValue(Texture, TextureBakerOutputHashKey, *OutputHash);
 			Texture->MarkPackageDirty();
 
+			FTextureBakerImageStats ImageStats;
+			if (Result.GetImageStats(ImageStats))
+			{
+				UE_LOG(LogTexture, Log, TEXT("Baked %s, value range min %s max %s"), *BaseAssetName, *ImageStats.Min.ToString(), *ImageStats.Max.ToString());
+			}
+
+			FString PackageFileName = FPackageName::LongPackageNameToFilename(AssetLongPackageName, FPackageName::GetAssetPackageExtension());
+			if (SaveQueue)
+			{
+				// Saved and registered together with the rest of the batch
+				SaveQueue->Add(PackageToSaveTexture, Texture, PackageFileName, FPlatformTime::Seconds() - StartTime, MoveTemp(CompressedSource));
+				return ETBSaveResult::Written;
+			}
+
+			if (CompressedSource.IsValid())
+			{
+				TextureBakerSourceCompression::ApplyCompressed(Texture, CompressedSource);
+			}
+
 			// Notify the asset registry
 			FAssetRegistryModule::AssetCreated(Texture);
 
-			FString PackageFileName = FPackageName::LongPackageNameToFilename(AssetLongPackageName, FPackageName::GetAssetPackageExtension());
-			UPackage::SavePackage(PackageToSaveTexture, Texture, RF_Standalone, *PackageFileName, GLog, nullptr, false, true, SAVE_None);
+			const bool bSaved = UPackage::SavePackage(PackageToSaveTexture, Texture, RF_Standalone, *PackageFileName, GLog, nullptr, false, true, SAVE_None);
+
+			// Source is saved, the build can read it on worker threads while the next outputs are baked
+			if (CompressionQueue)
+			{
+				CompressionQueue->Add(Texture);
+			}
+			return bSaved ? ETBSaveResult::Written : ETBSaveResult::Failed;
 		}
 	}
+	return ETBSaveResult::Failed;
 }
 
-void FTextureBakerModule::WriteTexture2DSourceArt(UTexture2D* InTexture2D, ETextureSourceFormat InTextureFormat, UTextureRenderTarget2D* SourceRT, ETBImageNormalization DataRange)
+bool FTextureBakerModule::ExportBakedImageResult(const FTextureBakerRenderResult& Result, FTextureBakerImageExporter& Exporter, FTextureBakerReadbackArena* ReadbackArena)
+{
+	if (!Result.IsValid())
+	{
+		return false;
+	}
+
+	// Exported image is the only host copy, tiles are stitched straight into it
+	TSharedPtr<FTextureBakerTiledImage> Image = Result.GetTiledImage();
+	UTextureRenderTarget2D* RenderTarget = Result.GetTextureRenderTarget();
+	if (Result.IsTiled())
+	{
+		Image->Data.SetNumUninitialized(uint64(FTextureSource::GetBytesPerPixel(Image->Format)) * Image->Size.X * Image->Size.Y);
+		if (!Result.RenderTiles())
+		{
+			return false;
+		}
+	}
+	else if (RenderTarget)
+	{
+		Image = MakeShared<FTextureBakerTiledImage>(FIntPoint(RenderTarget->SizeX, RenderTarget->SizeY), Result.GetInfo().OutputImageFormat);
+		Image->bSRGB = RenderTarget->IsSRGB();
+		ReadRenderTargetImage(Image->Format, RenderTarget, Result.GetInfo().Normalization, Result.GetPendingReadback(), Image->Data.GetData(), ReadbackArena);
+	}
+	if (!Image.IsValid())
+	{
+		return false;
+	}
+
+	FString OutputPath = Result.GetPackagePath();
+	FPaths::RemoveDuplicateSlashes(OutputPath);
+	const TCHAR* Extension = FTextureBakerImageExporter::GetFileExtension(Result.GetInfo().ExportFileFormat);
+	const FString FileName = FPackageName::IsValidLongPackageName(OutputPath) ? FPackageName::LongPackageNameToFilename(OutputPath, Extension) : OutputPath + Extension;
+
+	FTextureBakerImageStats ImageStats;
+	if (Result.GetImageStats(ImageStats))
+	{
+		UE_LOG(LogTexture, Log, TEXT("Baked %s, value range min %s max %s"), *FPaths::GetBaseFilename(FileName), *ImageStats.Min.ToString(), *ImageStats.Max.ToString());
+	}
+
+	Exporter.Export(Image.ToSharedRef(), Result.GetInfo().ExportFileFormat, FPaths::ConvertRelativePathToFull(FileName));
+	return true;
+}
+
+void FTextureBakerModule::WriteTexture2DSourceArt(UTexture2D* InTexture2D, ETextureSourceFormat InTextureFormat, UTextureRenderTarget2D* SourceRT, ETBImageNormalization DataRange, FTextureBakerPendingReadback* PendingReadback,
+	FTextureBakerReadbackArena* ReadbackArena, const FTextureBakerSourceMipSettings& MipSettings, bool bBuildTexture)
 {
 	if (InTexture2D && InTextureFormat == ETextureSourceFormat::TSF_Invalid)
 	{
@@ -185,70 +512,198 @@ void FTextureBakerModule::WriteTexture2DSourceArt(UTexture2D* InTexture2D, EText
 
 	if (InTexture2D && SourceRT)
 	{
-		FIntPoint Size(SourceRT->SizeX, SourceRT->SizeY);
-		FTextureRenderTargetResource* RenderTargetResource = SourceRT->GameThread_GetRenderTargetResource();
-		TSharedPtr<FTextureBakerSurfaceReadback> ReadbackHandler = GetReadbackHandler(InTextureFormat, SourceRT->IsSRGB(), DataRange);
+		const FIntPoint Size(SourceRT->SizeX, SourceRT->SizeY);
+		InTexture2D->Source.Init(Size.X, Size.Y, 1, MipSettings.bGenerateMips ? TextureBakerMips::GetNumMips(Size) : 1, InTextureFormat);
+		if (void* PixelDataBuffer = InTexture2D->Source.LockMip(0))
+		{
+			ReadRenderTargetImage(InTextureFormat, SourceRT, DataRange, PendingReadback, PixelDataBuffer, ReadbackArena);
+		}
+		InTexture2D->Source.UnlockMip(0);
+		FinishTexture2DSourceArt(InTexture2D, SourceRT->IsSRGB(), MipSettings, bBuildTexture);
+	}
+}
 
-		const uint64 ImagePixelBytes = FTextureSource::GetBytesPerPixel(InTextureFormat);
-		const uint64 ImagePixelsTotal = Size.X * Size.Y;
-		const uint64 ImageBytesSize = ImagePixelBytes * ImagePixelsTotal;
-		if (RenderTargetResource && ReadbackHandler)
+// Mip settings a bake overrides for the source it wrote. The replaced values are kept in package metadata and go back once a later
+// bake doesn't override them anymore, unless someone changed the setting in the meantime
+static const TCHAR* TextureBakerReplacedMipGenKey = TEXT("TextureBakerReplacedMipGenSettings");
+static const TCHAR* TextureBakerReplacedNeverStreamKey = TEXT("TextureBakerReplacedNeverStream");
+
+static void RestoreReplacedMipSettings(UTexture2D* Texture, UMetaData* MetaData)
+{
+	const bool bOverriddenMipGen = (Texture->MipGenSettings == TMGS_LeaveExistingMips || Texture->MipGenSettings == TMGS_NoMipmaps);
+	if (MetaData->HasValue(Texture, TextureBakerReplacedMipGenKey))
+	{
+		if (bOverriddenMipGen)
 		{
-			if (ReadbackHandler->DirectlyCompatibleWithImage(InTextureFormat))
-			{
-				InTexture2D->Source.Init(Size.X, Size.Y, 1, 1, InTextureFormat);
-				if (void* PixelDataBuffer = InTexture2D->Source.LockMip(0))
-				{
-					ReadbackHandler->ReadbackBuffer(RenderTargetResource, PixelDataBuffer);
-				}
-				InTexture2D->Source.UnlockMip(0);
-			}
-			else
-			{
-				// Allocate a buffer length enough to contain either transcoded or readback data and one extra transcoded pixel.
-				// Readback is placed with one pixel offset and then transcoder writes first readback pixel to a reserved pixel location
-				// and continues overlapped transcoding.
-				const uint64 ReadbackBytesSize = ReadbackHandler->GetRequiredReadbackBufferSize(Size, InTextureFormat);
-				void* PixelDataBuffer = FMemory::Malloc(ReadbackBytesSize);
-				ReadbackHandler->ReadbackBuffer(RenderTargetResource, PixelDataBuffer);
-				/*if (const void* EncodedDataPosition = ReadbackHandler->TranscodeToImageFormat(InTextureFormat, PixelDataBuffer, nullptr, ImagePixelsTotal, ReadbackBytesSize))
-				{
-					// Inline transcoding is possible, just pass result to the texture maker
-					InTexture2D->Source.Init(Size.X, Size.Y, 1, 1, InTextureFormat, (uint8*)EncodedDataPosition);
-				}
-				else*/
-				{
-					// Inline transcoding is impossible, transcode using locked mip as a secondary buffer
-					InTexture2D->Source.Init(Size.X, Size.Y, 1, 1, InTextureFormat);
-					if (void* OutputBuffer = InTexture2D->Source.LockMip(0))
-					{
-						ReadbackHandler->TranscodeToImageFormat(InTextureFormat, OutputBuffer, PixelDataBuffer, ImagePixelsTotal, ReadbackBytesSize);
-					}
-					InTexture2D->Source.UnlockMip(0);
-				}
-				FMemory::Free(PixelDataBuffer);
-			}
+			Texture->MipGenSettings = TextureMipGenSettings(FCString::Atoi(*MetaData->GetValue(Texture, TextureBakerReplacedMipGenKey)));
 		}
-		else
+		MetaData->RemoveValue(Texture, TextureBakerReplacedMipGenKey);
+	}
+	else if (Texture->MipGenSettings == TMGS_LeaveExistingMips && Texture->Source.GetNumMips() == 1)
+	{
+		// Baked before the replaced value was kept, there's no chain to leave anymore
+		Texture->MipGenSettings = TMGS_FromTextureGroup;
+	}
+	if (MetaData->HasValue(Texture, TextureBakerReplacedNeverStreamKey))
+	{
+		if (Texture->NeverStream)
 		{
-			InTexture2D->Source.Init(Size.X, Size.Y, 1, 1, InTextureFormat);
-			uint8* RawMemory = InTexture2D->Source.LockMip(0);
-			FMemory::Memset(RawMemory, 0, ImageBytesSize);
-			InTexture2D->Source.UnlockMip(0);
+			Texture->NeverStream = FCString::ToBool(*MetaData->GetValue(Texture, TextureBakerReplacedNeverStreamKey));
 		}
+		MetaData->RemoveValue(Texture, TextureBakerReplacedNeverStreamKey);
+	}
+}
+
+static void ReplaceMipSettings(UTexture2D* Texture, UMetaData* MetaData, TextureMipGenSettings MipGenSettings, bool bNeverStream)
+{
+	if (Texture->MipGenSettings != MipGenSettings)
+	{
+		MetaData->SetValue(Texture, TextureBakerReplacedMipGenKey, *FString::FromInt(Texture->MipGenSettings));
+		Texture->MipGenSettings = MipGenSettings;
+	}
+	if (bNeverStream && !Texture->NeverStream)
+	{
+		MetaData->SetValue(Texture, TextureBakerReplacedNeverStreamKey, TEXT("false"));
+		Texture->NeverStream = true;
+	}
+}
 
+void FTextureBakerModule::FinishTexture2DSourceArt(UTexture2D* InTexture2D, bool bSRGB, const FTextureBakerSourceMipSettings& MipSettings, bool bBuildTexture)
+{
+	UMetaData* MetaData = InTexture2D->GetOutermost()->GetMetaData();
+	RestoreReplacedMipSettings(InTexture2D, MetaData);
+
+	const bool bNonPowerOfTwo = InTexture2D->PowerOfTwoMode == ETexturePowerOfTwoSetting::None && (!InTexture2D->Source.IsPowerOfTwo());
+	if (MipSettings.bGenerateMips && InTexture2D->Source.GetNumMips() > 1)
+	{
+		// Chain is in the source already, the texture build only has to take it
+		TextureBakerMips::GenerateMipChain(InTexture2D->Source, bSRGB, MipSettings);
+		ReplaceMipSettings(InTexture2D, MetaData, TMGS_LeaveExistingMips, bNonPowerOfTwo);
+	}
+	else if (bNonPowerOfTwo)
+	{
 		// Disable mips if they're couldn't be generated
-		if (InTexture2D->PowerOfTwoMode == ETexturePowerOfTwoSetting::None && (!InTexture2D->Source.IsPowerOfTwo()))
+		ReplaceMipSettings(InTexture2D, MetaData, TMGS_NoMipmaps, true);
+	}
+	InTexture2D->SRGB = bSRGB;
+	//InTexture2D->ForceRebuildPlatformData();
+	if (bBuildTexture)
+	{
+		InTexture2D->UpdateResource();
+	}
+}
+
+void FTextureBakerModule::ReadRenderTargetImage(ETextureSourceFormat ImageFormat, UTextureRenderTarget2D* SourceRT, ETBImageNormalization DataRange, FTextureBakerPendingReadback* PendingReadback, void* ImageBuffer, FTextureBakerReadbackArena* ReadbackArena)
+{
+	check(SourceRT && ImageBuffer);
+	FIntPoint Size(SourceRT->SizeX, SourceRT->SizeY);
+	FTextureRenderTargetResource* RenderTargetResource = SourceRT->GameThread_GetRenderTargetResource();
+	TSharedPtr<FTextureBakerSurfaceReadback> ReadbackHandler = GetReadbackHandler(ImageFormat, SourceRT->RenderTargetFormat, SourceRT->IsSRGB(), DataRange);
+
+	const uint64 ImagePixelBytes = FTextureSource::GetBytesPerPixel(ImageFormat);
+	const uint64 ImagePixelsTotal = uint64(Size.X) * Size.Y;
+	const uint64 ImageBytesSize = ImagePixelBytes * ImagePixelsTotal;
+
+	// Staging copy is used if it was enqueued for this surface and the handler understands its layout, otherwise fall back to a blocking read
+	auto ReadSurface = [&](void* DestBuffer)
+	{
+		if (!PendingReadback || PendingReadback->GetSize() != Size || !PendingReadback->Resolve(*ReadbackHandler, DestBuffer))
 		{
-			InTexture2D->MipGenSettings = TMGS_NoMipmaps;
-			InTexture2D->NeverStream = true;
+			ReadbackHandler->ReadbackBuffer(RenderTargetResource, DestBuffer);
+		}
+	};
+
+	if (PendingReadback && PendingReadback->IsEncodedAs(ImageFormat) && PendingReadback->GetSize() == Size)
+	{
+		// Pixels were encoded on the GPU, readback data is the image itself
+		if (PendingReadback->ResolveEncoded(ImageBuffer, ImageBytesSize))
+		{
+			return;
 		}
-		InTexture2D->SRGB = SourceRT->IsSRGB();
-		//InTexture2D->ForceRebuildPlatformData();
-		InTexture2D->UpdateResource();
+	}
+
+	// Transcodes through a secondary buffer, InlineReadback is the surface already read into the image when inline transcoding was refused
+	auto TranscodeThroughBuffer = [&](const void* InlineReadback)
+	{
+		const uint64 ReadbackBytesSize = ReadbackHandler->GetRequiredReadbackBufferSize(Size);
+		void* PixelDataBuffer = ReadbackArena ? ReadbackArena->Acquire(ReadbackBytesSize) : FMemory::Malloc(ReadbackBytesSize);
+		if (InlineReadback)
+		{
+			FMemory::Memcpy(PixelDataBuffer, InlineReadback, ReadbackBytesSize);
+		}
+		else
+		{
+			ReadSurface(PixelDataBuffer);
+		}
+		TranscodeImage(*ReadbackHandler, ImageFormat, ImageBuffer, PixelDataBuffer, Size);
+		if (ReadbackArena)
+		{
+			ReadbackArena->Release(PixelDataBuffer);
+		}
+		else
+		{
+			FMemory::Free(PixelDataBuffer);
+		}
+	};
+
+	if (RenderTargetResource && ReadbackHandler)
+	{
+		if (ReadbackHandler->DirectlyCompatibleWithImage(ImageFormat))
+		{
+			ReadSurface(ImageBuffer);
+		}
+		else if (ReadbackHandler->GetRequiredReadbackBufferSize(Size, ImageFormat) <= ImageBytesSize)
+		{
+			// Image pixels are not smaller than readback ones: read straight into the image and transcode it in place.
+			// Handlers without an inline transcoder for this pair return nullptr and leave the buffer untouched
+			ReadSurface(ImageBuffer);
+			const void* EncodedData = ReadbackHandler->TranscodeToImageFormat(ImageFormat, ImageBuffer, nullptr, ImagePixelsTotal, ImageBytesSize);
+			if (EncodedData == nullptr)
+			{
+				TranscodeThroughBuffer(ImageBuffer);
+			}
+		}
+		else
+		{
+			// Readback doesn't fit into the image, transcode through a secondary buffer
+			TranscodeThroughBuffer(nullptr);
+		}
+	}
+	else
+	{
+		FMemory::Memset(ImageBuffer, 0, ImageBytesSize);
 	}
 }
 
+void FTextureBakerModule::TranscodeImage(const FTextureBakerSurfaceReadback& ReadbackHandler, ETextureSourceFormat ImageFormat, void* ImageDestBuffer, const void* ReadbackBuffer, const FIntPoint& Size)
+{
+	check(ImageDestBuffer && ReadbackBuffer);
+	const uint64 ImagePixelsTotal = uint64(Size.X) * Size.Y;
+	const uint64 ImageRowBytes = FTextureSource::GetBytesPerPixel(ImageFormat) * Size.X;
+	const uint64 ReadbackRowBytes = ReadbackHandler.GetRequiredReadbackBufferSize(FIntPoint(Size.X, 1));
+	const int32 ParallelMinPixels = CVarTextureBakerTranscodeParallelMinPixels.GetValueOnGameThread();
+
+	// Every pixel is independent, so bands of whole rows can be transcoded in any order with the same result
+	const uint64 BandBytes = uint64(FMath::Max(CVarTextureBakerTranscodeBandSize.GetValueOnGameThread(), 1)) * 1024;
+	const int32 RowsPerBand = FMath::Clamp<int32>(BandBytes / FMath::Max<uint64>(ReadbackRowBytes, 1), 1, FMath::Max(Size.Y, 1));
+	const int32 BandNum = FMath::DivideAndRoundUp(Size.Y, RowsPerBand);
+
+	if (ParallelMinPixels <= 0 || ImagePixelsTotal < uint64(ParallelMinPixels) || BandNum < 2)
+	{
+		ReadbackHandler.TranscodeToImageFormat(ImageFormat, ImageDestBuffer, ReadbackBuffer, ImagePixelsTotal, ImageRowBytes * Size.Y);
+		return;
+	}
+
+	ParallelFor(BandNum, [&](int32 BandIndex)
+	{
+		const int32 FirstRow = BandIndex * RowsPerBand;
+		const int32 RowNum = FMath::Min(RowsPerBand, Size.Y - FirstRow);
+		void* BandDest = FTextureBakerMath::OffsetPointer(ImageDestBuffer, FirstRow * ImageRowBytes);
+		const void* BandSource = FTextureBakerMath::OffsetPointer(ReadbackBuffer, FirstRow * ReadbackRowBytes);
+		ReadbackHandler.TranscodeToImageFormat(ImageFormat, BandDest, BandSource, uint64(RowNum) * Size.X, ImageRowBytes * RowNum);
+	});
+}
+
 ETextureRenderTargetFormat FTextureBakerModule::SelectRenderTargetFormatForPixelFormat(EPixelFormat PixelFormat, bool sRGB)
 {
 	switch (PixelFormat)
@@ -332,78 +787,88 @@ ETextureSourceFormat FTextureBakerModule::SelectImageSourceFormatForRenderTarget
 template <typename T> class FTextureBakerNativeReadback : public FTextureBakerSurfaceReadback
 {
 public:
+	typedef TextureBakerTranscoders::FTextureBakerTranscoder FTranscoder;
+
+	FTextureBakerNativeReadback(ETextureSourceFormat InImageFormat, bool bSRGB) : BoundImageFormat(InImageFormat), bTranscodeSRGB(bSRGB)
+	{
+		ImageTranscoder = ResolveTranscoder(BoundImageFormat);
+	}
+
 	virtual bool DirectlyCompatibleWithImage(ETextureSourceFormat ImageFormat) const override { return false; }
 	virtual uint64 GetRequiredReadbackBufferSize(const FIntPoint& TextureSize) const override { return InputPixelSize * TextureSize.X * TextureSize.Y; }
 	virtual uint64 GetRequiredReadbackBufferSize(const FIntPoint& TextureSize, ETextureSourceFormat InlineTranscodeTarget) const override
 	{
 		const uint64 ReadbackOutputSize = GetRequiredReadbackBufferSize(TextureSize);
 		const uint64 OutputPixelSize = FTextureSource::GetBytesPerPixel(InlineTranscodeTarget);
-		const uint64 PixelNum = TextureSize.X * TextureSize.Y;
-		const uint64 FinalTextureSize = OutputPixelSize * PixelNum;
-		const uint64 SafeguardArea = ComputeOverlappingEncoderSafeArea(InputPixelSize, OutputPixelSize, PixelNum);
-		return DirectlyCompatibleWithImage(InlineTranscodeTarget) ? ReadbackOutputSize : FMath::Max(FinalTextureSize + SafeguardArea, ReadbackOutputSize);
+		const uint64 PixelNum = uint64(TextureSize.X) * TextureSize.Y;
+		return DirectlyCompatibleWithImage(InlineTranscodeTarget) ? ReadbackOutputSize : GetInlineTranscodeBufferSize(OutputPixelSize, PixelNum);
 	}
 
-	virtual const void* TranscodeToImageFormat(ETextureSourceFormat ImageFormat, void* ImageDestBuffer, const void* ReadbackBuffer, uint64 PixelNum, uint64 BufferLength) const override
+	virtual const void* TranscodeToImageFormat(ETextureSourceFormat TargetFormat, void* ImageDestBuffer, const void* ReadbackBuffer, uint64 PixelNum, uint64 BufferLength) const override
 	{
 		check(ImageDestBuffer);
-		const uint64 OutputPixelSize = FTextureSource::GetBytesPerPixel(ImageFormat);
-		const uint64 SafeguardArea = ComputeOverlappingEncoderSafeArea(InputPixelSize, OutputPixelSize, PixelNum);
-		const uint64 OverlappedOutputPosition = OutputPixelSize * PixelNum + SafeguardArea;
+		const FTranscoder Transcoder = (TargetFormat == BoundImageFormat) ? ImageTranscoder : ResolveTranscoder(TargetFormat);
+		if (!Transcoder.IsValid())
+		{
+			return nullptr;
+		}
 
 		if (ReadbackBuffer)
 		{
 			// Non-overlapping transcoding
-			TranscodePixels(ImageFormat, ImageDestBuffer, ReadbackBuffer, OutputPixelSize, InputPixelSize, PixelNum);
+			Transcoder.Forward(ImageDestBuffer, ReadbackBuffer, PixelNum);
 			return ImageDestBuffer;
 		}
-		else if (BufferLength >= OverlappedOutputPosition + OutputPixelSize)
+		else if (BufferLength >= GetInlineTranscodeBufferSize(Transcoder.DestPixelSize, PixelNum))
 		{
-			// Inline transcoding. Have to align areas to make them non-overlapping
-			void* TranscoderOutputPosition = FTextureBakerMath::OffsetPointer(ImageDestBuffer, OverlappedOutputPosition);
-			const void* TranscoderInputPosition = FTextureBakerMath::OffsetPointer(ImageDestBuffer, InputPixelSize * PixelNum);
-			TranscodePixels(ImageFormat, TranscoderOutputPosition, TranscoderInputPosition, -FTextureBakerMath::Signed(OutputPixelSize), -FTextureBakerMath::Signed(InputPixelSize), PixelNum);
-			return FTextureBakerMath::OffsetPointer(ImageDestBuffer, SafeguardArea);
+			// Inline transcoding. Both images start at the beginning of the buffer and the walk direction guarantees that
+			// a written pixel never covers input which is not read yet: growing pixels walk backward, shrinking ones forward
+			if (Transcoder.DestPixelSize > InputPixelSize)
+			{
+				Transcoder.Reverse(ImageDestBuffer, ImageDestBuffer, PixelNum);
+			}
+			else
+			{
+				Transcoder.Forward(ImageDestBuffer, ImageDestBuffer, PixelNum);
+			}
+			return ImageDestBuffer;
 		}
 		return nullptr;
 	}
 
-	virtual void TranscodePixels(ETextureSourceFormat ImageFormat, void* DestPixels, const void* SrcPixels, int64 DestStep, int64 SrcStep, uint64 PixelNum) const = 0;
-
 protected:
-	const uint64 InputPixelSize = sizeof(T);
-	uint64 ComputeOverlappingEncoderSafeArea(uint64 SrcPixelSize, uint64 OutputPixelSize, uint64 PixelNum) const
+	FTranscoder ResolveTranscoder(ETextureSourceFormat TargetFormat) const
+	{
+		return TextureBakerTranscoders::GetTranscoder<T>(TargetFormat, bTranscodeSRGB, CVarTextureBakerVectorTranscode.GetValueOnAnyThread() != 0);
+	}
+
+	uint64 GetInlineTranscodeBufferSize(uint64 OutputPixelSize, uint64 PixelNum) const
 	{
-		const uint64 PixelBufferCoveringSpeed = OutputPixelSize - FMath::Min(SrcPixelSize, OutputPixelSize);
-		const uint64 SafeguardArea = PixelBufferCoveringSpeed * PixelNum + SrcPixelSize;
-		return SafeguardArea;
+		return FMath::Max(InputPixelSize, OutputPixelSize) * PixelNum;
 	}
+
+	const uint64 InputPixelSize = sizeof(T);
+	ETextureSourceFormat BoundImageFormat;
+	bool bTranscodeSRGB;
+	FTranscoder ImageTranscoder;
 };
 
 template <typename T> class FTextureBakerNativeMappedReadback : public FTextureBakerNativeReadback<T>
 {
 public:
-	FTextureBakerNativeMappedReadback() : RangeMappingMode(ERangeCompressionMode::RCM_UNorm) {}
-	FTextureBakerNativeMappedReadback(ERangeCompressionMode RangeMapping) : RangeMappingMode(RangeMapping) {}
+	FTextureBakerNativeMappedReadback(ETextureSourceFormat InImageFormat, bool bSRGB) : FTextureBakerNativeReadback<T>(InImageFormat, bSRGB), RangeMappingMode(ERangeCompressionMode::RCM_UNorm) {}
+	FTextureBakerNativeMappedReadback(ETextureSourceFormat InImageFormat, bool bSRGB, ERangeCompressionMode RangeMapping) : FTextureBakerNativeReadback<T>(InImageFormat, bSRGB), RangeMappingMode(RangeMapping) {}
 
 protected:
 	ERangeCompressionMode RangeMappingMode;
 };
 
-#if PLATFORM_LITTLE_ENDIAN
- #define _ToPackedBGRA ToPackedARGB
- #define _ToPackedRGBA ToPackedABGR
-#else // PLATFORM_LITTLE_ENDIAN
- #define _ToPackedBGRA ToPackedBGRA
- #define _ToPackedRGBA ToPackedRGBA
-#endif // !PLATFORM_LITTLE_ENDIAN
-
 class FTextureBakerLinearReadback : public FTextureBakerNativeMappedReadback<FLinearColor>
 {
 public:
 	
-	FTextureBakerLinearReadback() : FTextureBakerNativeMappedReadback<FLinearColor>(ERangeCompressionMode::RCM_UNorm), bInputInSRGB(true) {}
-	FTextureBakerLinearReadback(ERangeCompressionMode RangeMapping, bool bSRGBInput) : FTextureBakerNativeMappedReadback<FLinearColor>(RangeMapping), bInputInSRGB(bSRGBInput) {}
+	FTextureBakerLinearReadback(ETextureSourceFormat InImageFormat) : FTextureBakerNativeMappedReadback<FLinearColor>(InImageFormat, true, ERangeCompressionMode::RCM_UNorm), bInputInSRGB(true) {}
+	FTextureBakerLinearReadback(ETextureSourceFormat InImageFormat, ERangeCompressionMode RangeMapping, bool bSRGBInput) : FTextureBakerNativeMappedReadback<FLinearColor>(InImageFormat, bSRGBInput, RangeMapping), bInputInSRGB(bSRGBInput) {}
 
 	virtual void ReadbackBuffer(FTextureRenderTargetResource* SourceRT, void* DestBuffer) const override
 	{
@@ -414,61 +879,32 @@ public:
 		SourceRT->ReadLinearColorPixelsPtr((FLinearColor*)DestBuffer, Options);
 	}
 
-	virtual void TranscodePixels(ETextureSourceFormat ImageFormat, void* DestPixels, const void* SrcPixels, int64 DestStep, int64 SrcStep, uint64 PixelNum) const override
+	virtual bool SupportsStagingReadback(EPixelFormat SurfaceFormat) const override
+	{
+		// Other range mappings rescale float surfaces by the image min/max during ReadLinearColorPixels, raw staging data doesn't match them
+		return RangeMappingMode == ERangeCompressionMode::RCM_MinMax && (SurfaceFormat == PF_A32B32G32R32F || SurfaceFormat == PF_FloatRGBA);
+	}
+
+	virtual void ReadbackStagingSurface(const void* SurfaceData, int32 RowPitchInPixels, EPixelFormat SurfaceFormat, const FIntPoint& Size, void* DestBuffer) const override
 	{
-		for (uint64 PixelIndex = 0; PixelIndex < PixelNum; PixelIndex++)
+		for (int32 Row = 0; Row < Size.Y; Row++)
 		{
-			switch (ImageFormat)
-			{
-			case ETextureSourceFormat::TSF_BGRA8:
-			{
-				*reinterpret_cast<uint32*>(DestPixels) = reinterpret_cast<const FLinearColor*>(SrcPixels)->ToFColor(bInputInSRGB)._ToPackedBGRA();
-				break;
-			}
-			case ETextureSourceFormat::TSF_BGRE8:
-			{
-				*reinterpret_cast<uint32*>(DestPixels) = reinterpret_cast<const FLinearColor*>(SrcPixels)->ToRGBE()._ToPackedBGRA();
-				break;
-			}
-			case ETextureSourceFormat::TSF_G16:
-			{
-				*reinterpret_cast<uint16*>(DestPixels) = reinterpret_cast<const FLinearColor*>(SrcPixels)->GetLuminance() * 65535;
-				break;
-			}
-			case ETextureSourceFormat::TSF_G8:
-			{
-				*reinterpret_cast<uint8*>(DestPixels) = reinterpret_cast<const FLinearColor*>(SrcPixels)->GetLuminance() * 255;
-				break;
-			}
-			case ETextureSourceFormat::TSF_RGBA16:
-			{
-				const FLinearColor SourceColor = *reinterpret_cast<const FLinearColor*>(SrcPixels);
-				reinterpret_cast<uint16*>(DestPixels)[0] = FMath::Clamp(SourceColor.R, 0.0f, 1.0f) * 65535;
-				reinterpret_cast<uint16*>(DestPixels)[1] = FMath::Clamp(SourceColor.G, 0.0f, 1.0f) * 65535;
-				reinterpret_cast<uint16*>(DestPixels)[2] = FMath::Clamp(SourceColor.B, 0.0f, 1.0f) * 65535;
-				reinterpret_cast<uint16*>(DestPixels)[3] = FMath::Clamp(SourceColor.A, 0.0f, 1.0f) * 65535;
-				break;
-			}
-			case ETextureSourceFormat::TSF_RGBA16F:
-			{
-				*reinterpret_cast<FFloat16Color*>(DestPixels) = FFloat16Color(*reinterpret_cast<const FLinearColor*>(SrcPixels));
-				break;
-			}
-			case ETextureSourceFormat::TSF_RGBA8:
+			FLinearColor* DestRow = static_cast<FLinearColor*>(DestBuffer) + int64(Row) * Size.X;
+			if (SurfaceFormat == PF_A32B32G32R32F)
 			{
-				*reinterpret_cast<uint32*>(DestPixels) = reinterpret_cast<const FLinearColor*>(SrcPixels)->ToFColor(false)._ToPackedRGBA();
-				break;
+				FMemory::Memcpy(DestRow, static_cast<const FLinearColor*>(SurfaceData) + int64(Row) * RowPitchInPixels, Size.X * sizeof(FLinearColor));
 			}
-			case ETextureSourceFormat::TSF_RGBE8:
+			else
 			{
-				*reinterpret_cast<uint32*>(DestPixels) = reinterpret_cast<const FLinearColor*>(SrcPixels)->ToRGBE()._ToPackedRGBA();
-				break;
-			}
+				const FFloat16Color* SourceRow = static_cast<const FFloat16Color*>(SurfaceData) + int64(Row) * RowPitchInPixels;
+				for (int32 Column = 0; Column < Size.X; Column++)
+				{
+					DestRow[Column] = FLinearColor(SourceRow[Column]);
+				}
 			}
-			DestPixels = FTextureBakerMath::OffsetPointer(DestPixels, DestStep);
-			SrcPixels = FTextureBakerMath::OffsetPointer(SrcPixels, SrcStep);
 		}
 	}
+
 protected:
 	bool bInputInSRGB;
 };
@@ -476,8 +912,8 @@ protected:
 class FTextureBakerColorReadback : public FTextureBakerNativeMappedReadback<FColor>
 {
 public:
-	FTextureBakerColorReadback() : FTextureBakerNativeMappedReadback<FColor>(ERangeCompressionMode::RCM_UNorm), bInputInSRGB(true) {}
-	FTextureBakerColorReadback(ERangeCompressionMode RangeMapping, bool bSRGBInput) : FTextureBakerNativeMappedReadback<FColor>(RangeMapping), bInputInSRGB(bSRGBInput) {}
+	FTextureBakerColorReadback(ETextureSourceFormat InImageFormat) : FTextureBakerNativeMappedReadback<FColor>(InImageFormat, true, ERangeCompressionMode::RCM_UNorm), bInputInSRGB(true) {}
+	FTextureBakerColorReadback(ETextureSourceFormat InImageFormat, ERangeCompressionMode RangeMapping, bool bSRGBInput) : FTextureBakerNativeMappedReadback<FColor>(InImageFormat, bSRGBInput, RangeMapping), bInputInSRGB(bSRGBInput) {}
 	virtual bool DirectlyCompatibleWithImage(ETextureSourceFormat ImageFormat) const override { return ImageFormat == ETextureSourceFormat::TSF_BGRA8; }
 
 	virtual void ReadbackBuffer(FTextureRenderTargetResource* SourceRT, void* DestBuffer) const override
@@ -489,63 +925,131 @@ public:
 		SourceRT->ReadPixelsPtr((FColor*)DestBuffer, Options);
 	}
 
-	virtual void TranscodePixels(ETextureSourceFormat ImageFormat, void* DestPixels, const void* SrcPixels, int64 DestStep, int64 SrcStep, uint64 PixelNum) const override
+	virtual bool SupportsStagingReadback(EPixelFormat SurfaceFormat) const override
 	{
-		for (uint64 PixelIndex = 0; PixelIndex < PixelNum; PixelIndex++)
+		// 8 bit surfaces are returned by ReadPixels as is, whatever range mapping is requested
+		return SurfaceFormat == PF_B8G8R8A8 || SurfaceFormat == PF_R8G8B8A8;
+	}
+
+	virtual void ReadbackStagingSurface(const void* SurfaceData, int32 RowPitchInPixels, EPixelFormat SurfaceFormat, const FIntPoint& Size, void* DestBuffer) const override
+	{
+		// Swapping R and B is symmetric, so RGBA8 rows are brought to FColor layout by the FColor -> RGBA8 transcoder
+		const FTranscoder RowTranscoder = ResolveTranscoder(SurfaceFormat == PF_B8G8R8A8 ? ETextureSourceFormat::TSF_BGRA8 : ETextureSourceFormat::TSF_RGBA8);
+		for (int32 Row = 0; Row < Size.Y; Row++)
 		{
-			switch (ImageFormat)
-			{
-			case ETextureSourceFormat::TSF_BGRA8:
-			{
-				*reinterpret_cast<uint32*>(DestPixels) = reinterpret_cast<const FColor*>(SrcPixels)->_ToPackedBGRA();
-				break;
-			}
-			case ETextureSourceFormat::TSF_BGRE8:
-			{
-				*reinterpret_cast<uint32*>(DestPixels) = FLinearColor(*reinterpret_cast<const FColor*>(SrcPixels)).ToRGBE()._ToPackedBGRA();
-				break;
-			}
-			case ETextureSourceFormat::TSF_G16:
-			{
-				*reinterpret_cast<uint16*>(DestPixels) = FLinearColor(*reinterpret_cast<const FColor*>(SrcPixels)).GetLuminance() * 65535;
-				break;
-			}
-			case ETextureSourceFormat::TSF_G8:
-			{
-				*reinterpret_cast<uint8*>(DestPixels) = FLinearColor(*reinterpret_cast<const FColor*>(SrcPixels)).GetLuminance() * 255;
-				break;
-			}
-			case ETextureSourceFormat::TSF_RGBA16:
-			{
-				const FLinearColor SourceColor(*reinterpret_cast<const FColor*>(SrcPixels));
-				reinterpret_cast<uint16*>(DestPixels)[0] = FMath::Clamp(SourceColor.R, 0.0f, 1.0f) * 65535;
-				reinterpret_cast<uint16*>(DestPixels)[1] = FMath::Clamp(SourceColor.G, 0.0f, 1.0f) * 65535;
-				reinterpret_cast<uint16*>(DestPixels)[2] = FMath::Clamp(SourceColor.B, 0.0f, 1.0f) * 65535;
-				reinterpret_cast<uint16*>(DestPixels)[3] = FMath::Clamp(SourceColor.A, 0.0f, 1.0f) * 65535;
-				break;
-			}
-			case ETextureSourceFormat::TSF_RGBA16F:
-			{
-				*reinterpret_cast<FFloat16Color*>(DestPixels) = FFloat16Color(FLinearColor(*reinterpret_cast<const FColor*>(SrcPixels)));
-				break;
-			}
-			case ETextureSourceFormat::TSF_RGBA8:
+			RowTranscoder.Forward(static_cast<FColor*>(DestBuffer) + int64(Row) * Size.X, static_cast<const FColor*>(SurfaceData) + int64(Row) * RowPitchInPixels, Size.X);
+		}
+	}
+
+protected:
+	bool bInputInSRGB;
+};
+
+// Blocking read of a whole surface through a staging copy. Engine readback APIs widen these surfaces to FColor or FLinearColor images,
+// the staging copy is handed to the handler in the surface's own layout instead
+static bool ReadStagingSurface(FTextureRenderTargetResource* SourceRT, const FTextureBakerSurfaceReadback& Handler, void* DestBuffer)
+{
+	bool bRead = false;
+	bool* bReadPtr = &bRead;
+	const FTextureBakerSurfaceReadback* LocalHandler = &Handler;
+	ENQUEUE_RENDER_COMMAND(TextureBakerReadStagingSurface)(
+		[SourceRT, LocalHandler, DestBuffer, bReadPtr](FRHICommandListImmediate& RHICmdList)
+		{
+			FRHITexture* SourceTexture = SourceRT->GetRenderTargetTexture();
+			if (!SourceTexture || !LocalHandler->SupportsStagingReadback(SourceTexture->GetFormat()))
 			{
-				*reinterpret_cast<uint32*>(DestPixels) = reinterpret_cast<const FColor*>(SrcPixels)->_ToPackedRGBA();
-				break;
+				return;
 			}
-			case ETextureSourceFormat::TSF_RGBE8:
+
+			FRHIGPUTextureReadback Readback(TEXT("TextureBakerBlockingReadback"));
+			RHICmdList.Transition(FRHITransitionInfo(SourceTexture, ERHIAccess::Unknown, ERHIAccess::CopySrc));
+			Readback.EnqueueCopy(RHICmdList, SourceTexture);
+			RHICmdList.Transition(FRHITransitionInfo(SourceTexture, ERHIAccess::CopySrc, ERHIAccess::SRVMask));
+			RHICmdList.BlockUntilGPUIdle();
+
+			void* SurfaceData = nullptr;
+			int32 RowPitchInPixels = 0;
+			Readback.LockTexture(RHICmdList, SurfaceData, RowPitchInPixels);
+			if (SurfaceData)
 			{
-				*reinterpret_cast<uint32*>(DestPixels) = FLinearColor(*reinterpret_cast<const FColor*>(SrcPixels)).ToRGBE()._ToPackedRGBA();
-				break;
+				LocalHandler->ReadbackStagingSurface(SurfaceData, RowPitchInPixels, SourceTexture->GetFormat(), SourceRT->GetSizeXY(), DestBuffer);
+				*bReadPtr = true;
 			}
-			}
-			DestPixels = FTextureBakerMath::OffsetPointer(DestPixels, DestStep);
-			SrcPixels = FTextureBakerMath::OffsetPointer(SrcPixels, SrcStep);
+			Readback.Unlock();
+		});
+
+	// Handler, destination buffer and result flag live on this stack frame
+	FlushRenderingCommands();
+	return bRead;
+}
+
+// Float pixels get what ReadLinearColorPixels does to float surfaces with RCM_UNorm: each channel is rescaled by its min/max over the
+// image, with the range extended to cover [0, 1]. Channels within [0, 1] are kept as is. Unorm pixels are in range by definition
+template <typename T> static void ExpandPixelsToUnitRange(T* Pixels, uint64 PixelNum)
+{
+	FLinearColor MinValue(0.0f, 0.0f, 0.0f, 0.0f);
+	FLinearColor MaxValue(1.0f, 1.0f, 1.0f, 1.0f);
+	for (uint64 Index = 0; Index < PixelNum; Index++)
+	{
+		const FLinearColor Value(Pixels[Index]);
+		MinValue = FLinearColor(FMath::Min(MinValue.R, Value.R), FMath::Min(MinValue.G, Value.G), FMath::Min(MinValue.B, Value.B), FMath::Min(MinValue.A, Value.A));
+		MaxValue = FLinearColor(FMath::Max(MaxValue.R, Value.R), FMath::Max(MaxValue.G, Value.G), FMath::Max(MaxValue.B, Value.B), FMath::Max(MaxValue.A, Value.A));
+	}
+	if (MinValue == FLinearColor(0.0f, 0.0f, 0.0f, 0.0f) && MaxValue == FLinearColor(1.0f, 1.0f, 1.0f, 1.0f))
+	{
+		return;
+	}
+
+	const FLinearColor Range = MaxValue - MinValue;
+	for (uint64 Index = 0; Index < PixelNum; Index++)
+	{
+		Pixels[Index] = T((FLinearColor(Pixels[Index]) - MinValue) / Range);
+	}
+}
+
+template <typename T> static void SaturatePixels(T* Pixels, uint64 PixelNum) {}
+static void SaturatePixels(FFloat16Color* Pixels, uint64 PixelNum) { ExpandPixelsToUnitRange(Pixels, PixelNum); }
+static void SaturatePixels(FLinearColor* Pixels, uint64 PixelNum) { ExpandPixelsToUnitRange(Pixels, PixelNum); }
+
+// Reads surface in its own pixel layout. Staging copies are taken as is, blocking reads take a staging copy of their own.
+// Saturate range mapping rescales float pixels the way the engine readback does, Normalize keeps raw values.
+template <typename T> class FTextureBakerNativeSurfaceReadback : public FTextureBakerNativeReadback<T>
+{
+public:
+	FTextureBakerNativeSurfaceReadback(ETextureSourceFormat InImageFormat, EPixelFormat InSurfaceFormat, ETextureSourceFormat InNativeImageFormat, bool bSRGB, bool bInSaturate) :
+		FTextureBakerNativeReadback<T>(InImageFormat, bSRGB), SurfaceFormat(InSurfaceFormat), NativeImageFormat(InNativeImageFormat), bSaturate(bInSaturate) {}
+
+	virtual bool DirectlyCompatibleWithImage(ETextureSourceFormat ImageFormat) const override { return ImageFormat != ETextureSourceFormat::TSF_Invalid && ImageFormat == NativeImageFormat; }
+
+	virtual void ReadbackBuffer(FTextureRenderTargetResource* SourceRT, void* DestBuffer) const override
+	{
+		check(SourceRT);
+		check(DestBuffer);
+		if (!ReadStagingSurface(SourceRT, *this, DestBuffer))
+		{
+			UE_LOG(LogTexture, Error, TEXT("Surface of %dx%d couldn't be read back"), SourceRT->GetSizeXY().X, SourceRT->GetSizeXY().Y);
+			FMemory::Memzero(DestBuffer, this->GetRequiredReadbackBufferSize(SourceRT->GetSizeXY()));
 		}
 	}
+
+	virtual bool SupportsStagingReadback(EPixelFormat InSurfaceFormat) const override { return InSurfaceFormat == SurfaceFormat; }
+
+	virtual void ReadbackStagingSurface(const void* SurfaceData, int32 RowPitchInPixels, EPixelFormat InSurfaceFormat, const FIntPoint& Size, void* DestBuffer) const override
+	{
+		for (int32 Row = 0; Row < Size.Y; Row++)
+		{
+			FMemory::Memcpy(static_cast<T*>(DestBuffer) + int64(Row) * Size.X, static_cast<const T*>(SurfaceData) + int64(Row) * RowPitchInPixels, Size.X * sizeof(T));
+		}
+		if (bSaturate)
+		{
+			SaturatePixels(static_cast<T*>(DestBuffer), uint64(Size.X) * Size.Y);
+		}
+	}
+
 protected:
-	bool bInputInSRGB;
+	EPixelFormat SurfaceFormat;
+	ETextureSourceFormat NativeImageFormat;
+	bool bSaturate;
 };
 
 ERangeCompressionMode ReadbackNormalizationMode(ETBImageNormalization DataRange)
@@ -570,14 +1074,45 @@ TSharedPtr<FTextureBakerSurfaceReadback> FTextureBakerModule::GetReadbackHandler
 	{
 	case ETextureSourceFormat::TSF_BGRA8:
 	case ETextureSourceFormat::TSF_G8:
-		return MakeShared<FTextureBakerColorReadback>(CompressionMode, sRGB);
+		return MakeShared<FTextureBakerColorReadback>(OutputFormat, CompressionMode, sRGB);
 
 	default:
-		return MakeShared<FTextureBakerLinearReadback>(CompressionMode, sRGB);
+		return MakeShared<FTextureBakerLinearReadback>(OutputFormat, CompressionMode, sRGB);
 	}
 	return nullptr;
 }
 
+TSharedPtr<FTextureBakerSurfaceReadback> FTextureBakerModule::GetReadbackHandler(ETextureSourceFormat OutputFormat, ETextureRenderTargetFormat SurfaceFormat, bool sRGB, ETBImageNormalization DataRange)
+{
+	// Auto normalization relies on the image min/max computed by the engine readback
+	if (DataRange != ETBImageNormalization::Auto)
+	{
+		using namespace TextureBakerTranscoders;
+		const EPixelFormat SurfacePixelFormat = GetPixelFormatFromRenderTargetFormat(SurfaceFormat);
+		const bool bSaturate = (DataRange == ETBImageNormalization::Saturate);
+		switch (SurfaceFormat)
+		{
+		case ETextureRenderTargetFormat::RTF_R8:
+			// G8 images keep the sRGB decode and luminance of FColor readbacks, so the surface isn't copied as is
+			return MakeShared<FTextureBakerNativeSurfaceReadback<uint8>>(OutputFormat, SurfacePixelFormat, ETextureSourceFormat::TSF_Invalid, sRGB, bSaturate);
+		case ETextureRenderTargetFormat::RTF_RG8:
+			return MakeShared<FTextureBakerNativeSurfaceReadback<FTextureBakerRG8Pixel>>(OutputFormat, SurfacePixelFormat, ETextureSourceFormat::TSF_Invalid, sRGB, bSaturate);
+		case ETextureRenderTargetFormat::RTF_R16f:
+			// Saturated single channel half surfaces keep the engine conversion, it isn't reproduced on raw surface data
+			if (!bSaturate)
+			{
+				return MakeShared<FTextureBakerNativeSurfaceReadback<FFloat16>>(OutputFormat, SurfacePixelFormat, ETextureSourceFormat::TSF_Invalid, sRGB, false);
+			}
+			break;
+		case ETextureRenderTargetFormat::RTF_RGBA16f:
+			return MakeShared<FTextureBakerNativeSurfaceReadback<FFloat16Color>>(OutputFormat, SurfacePixelFormat, ETextureSourceFormat::TSF_RGBA16F, sRGB, bSaturate);
+		case ETextureRenderTargetFormat::RTF_RGBA32f:
+			return MakeShared<FTextureBakerNativeSurfaceReadback<FLinearColor>>(OutputFormat, SurfacePixelFormat, ETextureSourceFormat::TSF_Invalid, sRGB, bSaturate);
+		}
+	}
+	return GetReadbackHandler(OutputFormat, sRGB, DataRange);
+}
+
 
 #undef LOCTEXT_NAMESPACE
 	
@@ -0,0 +1,333 @@
+#include "TextureBaker.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/AutomationTest.h"
+#include "Math/RandomStream.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/DateTime.h"
+#include "Misc/PackageName.h"
+#include "HAL/FileManager.h"
+#include "UObject/Package.h"
+#include "TextureBakerSourceCompression.h"
+
+// CPU only benchmark of readback handlers. Synthetic readback data is fed straight into the transcoders, so it runs
+// headless and without a GPU, e.g. UE4Editor-Cmd <Project> -nullrhi -ExecCmds="TextureBaker.BenchmarkTranscoders; Quit"
+namespace TextureBakerBenchmark
+{
+	struct FCase
+	{
+		ETextureRenderTargetFormat SurfaceFormat;
+		ETextureSourceFormat ImageFormat;
+		ETBImageNormalization Normalization;
+		FIntPoint Size;
+	};
+
+	struct FResult
+	{
+		const TCHAR* Path;
+		double Seconds;
+		uint64 ProcessedBytes;
+		uint64 PeakBytes;
+	};
+
+	static const TCHAR* GetNormalizationName(ETBImageNormalization Normalization)
+	{
+		switch (Normalization)
+		{
+		case ETBImageNormalization::Saturate: return TEXT("Saturate");
+		case ETBImageNormalization::Normalize: return TEXT("Normalize");
+		case ETBImageNormalization::Auto: return TEXT("Auto");
+		}
+		return TEXT("Unknown");
+	}
+
+	// Best time of all iterations, Prepare runs before each iteration and isn't timed
+	template <typename PrepareFunc, typename RunFunc>
+	static double MeasureBest(int32 Iterations, PrepareFunc&& Prepare, RunFunc&& Run)
+	{
+		double BestSeconds = TNumericLimits<double>::Max();
+		for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			Prepare();
+			const double StartTime = FPlatformTime::Seconds();
+			Run();
+			BestSeconds = FMath::Min(BestSeconds, FPlatformTime::Seconds() - StartTime);
+		}
+		return BestSeconds;
+	}
+
+	static void RunCase(const FCase& Case, int32 Iterations, TArray<FResult>& OutResults)
+	{
+		const bool bSRGB = (Case.SurfaceFormat == ETextureRenderTargetFormat::RTF_RGBA8_SRGB);
+		TSharedPtr<FTextureBakerSurfaceReadback> Handler = FTextureBakerModule::GetReadbackHandler(Case.ImageFormat, Case.SurfaceFormat, bSRGB, Case.Normalization);
+		if (!Handler.IsValid())
+		{
+			return;
+		}
+
+		const uint64 PixelNum = uint64(Case.Size.X) * Case.Size.Y;
+		const uint64 ReadbackBytes = Handler->GetRequiredReadbackBufferSize(Case.Size);
+		const uint64 ImageBytes = PixelNum * FTextureSource::GetBytesPerPixel(Case.ImageFormat);
+
+		// Bytes are kept in the range of finite floats and halves, so NaN handling doesn't skew float paths
+		TArray64<uint8> Reference;
+		Reference.SetNumUninitialized(ReadbackBytes);
+		FRandomStream Random(int32(ReadbackBytes));
+		for (uint8& Byte : Reference)
+		{
+			Byte = uint8(Random.RandRange(0, 0x3B));
+		}
+
+		TArray64<uint8> Readback;
+		TArray64<uint8> Image;
+		if (Handler->DirectlyCompatibleWithImage(Case.ImageFormat))
+		{
+			Image.SetNumUninitialized(ImageBytes);
+			const double Seconds = MeasureBest(Iterations, [] {}, [&] { FMemory::Memcpy(Image.GetData(), Reference.GetData(), ImageBytes); });
+			OutResults.Add({ TEXT("Direct"), Seconds, ReadbackBytes, ReadbackBytes + ImageBytes });
+			return;
+		}
+
+		Image.SetNumUninitialized(ImageBytes);
+		{
+			const double Seconds = MeasureBest(Iterations, [] {}, [&]
+			{
+				FTextureBakerModule::TranscodeImage(*Handler, Case.ImageFormat, Image.GetData(), Reference.GetData(), Case.Size);
+			});
+			OutResults.Add({ TEXT("Regular"), Seconds, ReadbackBytes, ReadbackBytes + ImageBytes });
+		}
+		Image.Empty();
+
+		const uint64 InlineBytes = FMath::Max(Handler->GetRequiredReadbackBufferSize(Case.Size, Case.ImageFormat), ReadbackBytes);
+		Readback.SetNumUninitialized(InlineBytes);
+		bool bInlineSupported = true;
+		const double InlineSeconds = MeasureBest(Iterations, [&] { FMemory::Memcpy(Readback.GetData(), Reference.GetData(), ReadbackBytes); }, [&]
+		{
+			bInlineSupported &= (Handler->TranscodeToImageFormat(Case.ImageFormat, Readback.GetData(), nullptr, PixelNum, InlineBytes) != nullptr);
+		});
+		if (bInlineSupported)
+		{
+			OutResults.Add({ TEXT("Inline"), InlineSeconds, ReadbackBytes, ReadbackBytes + InlineBytes });
+		}
+	}
+
+	static bool RunBenchmark(const TArray<FString>& Args)
+	{
+		TArray<int32> Sizes;
+		int32 Iterations = 5;
+		for (const FString& Arg : Args)
+		{
+			if (Arg.StartsWith(TEXT("Iterations=")))
+			{
+				Iterations = FMath::Max(1, FCString::Atoi(*Arg.RightChop(11)));
+			}
+			else if (Arg.IsNumeric())
+			{
+				Sizes.Add(FMath::Clamp(FCString::Atoi(*Arg), 1, FTextureBakerOutputInfo::MaxOutputSize));
+			}
+		}
+		if (Sizes.Num() == 0)
+		{
+			Sizes = { 256, 1024, 2048 };
+		}
+
+		const ETextureRenderTargetFormat SurfaceFormats[] = {
+			ETextureRenderTargetFormat::RTF_R8, ETextureRenderTargetFormat::RTF_RG8, ETextureRenderTargetFormat::RTF_RGBA8, ETextureRenderTargetFormat::RTF_RGBA8_SRGB,
+			ETextureRenderTargetFormat::RTF_R16f, ETextureRenderTargetFormat::RTF_RGBA16f, ETextureRenderTargetFormat::RTF_RGBA32f
+		};
+		const ETextureSourceFormat ImageFormats[] = {
+			ETextureSourceFormat::TSF_G8, ETextureSourceFormat::TSF_BGRA8, ETextureSourceFormat::TSF_BGRE8, ETextureSourceFormat::TSF_RGBA16,
+			ETextureSourceFormat::TSF_RGBA16F, ETextureSourceFormat::TSF_RGBA8, ETextureSourceFormat::TSF_RGBE8, ETextureSourceFormat::TSF_G16
+		};
+		const ETBImageNormalization Normalizations[] = { ETBImageNormalization::Saturate, ETBImageNormalization::Normalize };
+
+		UEnum* SurfaceFormatEnum = StaticEnum<ETextureRenderTargetFormat>();
+		UEnum* ImageFormatEnum = StaticEnum<ETextureSourceFormat>();
+		FString Report = TEXT("surface_format,image_format,normalization,width,height,path,seconds,mb_per_s,ns_per_pixel,peak_bytes\n");
+		for (int32 Size : Sizes)
+		{
+			for (ETextureRenderTargetFormat SurfaceFormat : SurfaceFormats)
+			{
+				for (ETextureSourceFormat ImageFormat : ImageFormats)
+				{
+					for (ETBImageNormalization Normalization : Normalizations)
+					{
+						const FCase Case = { SurfaceFormat, ImageFormat, Normalization, FIntPoint(Size, Size) };
+						TArray<FResult> Results;
+						RunCase(Case, Iterations, Results);
+						for (const FResult& Result : Results)
+						{
+							const double Seconds = FMath::Max(Result.Seconds, 1e-9);
+							Report += FString::Printf(TEXT("%s,%s,%s,%d,%d,%s,%.6f,%.1f,%.3f,%llu\n"),
+								*SurfaceFormatEnum->GetNameStringByValue(int64(SurfaceFormat)), *ImageFormatEnum->GetNameStringByValue(int64(ImageFormat)),
+								GetNormalizationName(Normalization), Size, Size, Result.Path, Seconds, Result.ProcessedBytes / (Seconds * 1024.0 * 1024.0),
+								Seconds * 1e9 / (double(Size) * Size), Result.PeakBytes);
+						}
+					}
+				}
+			}
+		}
+
+		const FString ReportPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("TextureBaker"), FString::Printf(TEXT("TranscodeBenchmark-%s.csv"), *FDateTime::Now().ToString()));
+		if (!FFileHelper::SaveStringToFile(Report, *ReportPath))
+		{
+			UE_LOG(LogTexture, Error, TEXT("Failed to write transcoder benchmark to %s"), *ReportPath);
+			return false;
+		}
+		UE_LOG(LogTexture, Display, TEXT("Transcoder benchmark written to %s"), *ReportPath);
+		return true;
+	}
+
+	static void Run(const TArray<FString>& Args)
+	{
+		RunBenchmark(Args);
+	}
+}
+
+// Compares baked source art stored raw and PNG compressed: package size, time to encode and save it, and time to read the
+// package file back and decode the source the way LockMip does. Real textures are used when given, synthetic masks otherwise
+namespace TextureBakerSourceCompressionBenchmark
+{
+	// Smooth gradients with a little noise, close to what baked masks compress like
+	static void MakeSyntheticImage(const FIntPoint& Size, ETextureSourceFormat Format, TArray64<uint8>& OutImage)
+	{
+		const int32 PixelBytes = FTextureSource::GetBytesPerPixel(Format);
+		OutImage.SetNumUninitialized(int64(PixelBytes) * Size.X * Size.Y);
+		FRandomStream Random(Size.X);
+		for (int32 Y = 0; Y < Size.Y; Y++)
+		{
+			for (int32 X = 0; X < Size.X; X++)
+			{
+				const float Value = 0.5f + 0.5f * FMath::Sin(X * 0.01f) * FMath::Cos(Y * 0.013f) + Random.FRandRange(-0.01f, 0.01f);
+				uint8* Pixel = &OutImage[(int64(Y) * Size.X + X) * PixelBytes];
+				for (int32 Byte = 0; Byte < PixelBytes; Byte++)
+				{
+					Pixel[Byte] = uint8(FMath::Clamp(Value, 0.0f, 1.0f) * 255.0f);
+				}
+			}
+		}
+	}
+
+	static FString RunCase(const FString& Name, const FIntPoint& Size, ETextureSourceFormat Format, const TArray64<uint8>& Image, int32 Iterations)
+	{
+		FString Rows;
+		for (const bool bCompressed : { false, true })
+		{
+			const FString PackageName = FString::Printf(TEXT("/Temp/TextureBaker/SourceCompressionBenchmark_%s"), bCompressed ? TEXT("PNG") : TEXT("Raw"));
+			const FString FileName = FPackageName::LongPackageNameToFilename(PackageName, FPackageName::GetAssetPackageExtension());
+			UPackage* Package = CreatePackage(*PackageName);
+			UTexture2D* Texture = NewObject<UTexture2D>(Package, TEXT("Benchmark"), RF_Public | RF_Standalone);
+			Texture->Source.Init(Size.X, Size.Y, 1, 1, Format, Image.GetData());
+			if (bCompressed && !TextureBakerSourceCompression::CanCompress(Texture->Source))
+			{
+				Texture->ClearFlags(RF_Public | RF_Standalone);
+				break;
+			}
+
+			double SaveSeconds = TNumericLimits<double>::Max();
+			double LoadSeconds = TNumericLimits<double>::Max();
+			bool bMatches = true;
+			for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+			{
+				Texture->Source.Init(Size.X, Size.Y, 1, 1, Format, Image.GetData());
+				const double SaveStartTime = FPlatformTime::Seconds();
+				if (bCompressed)
+				{
+					TFuture<TArray64<uint8>> CompressedData = TextureBakerSourceCompression::BeginCompress(Texture->Source, Image.GetData());
+					TextureBakerSourceCompression::ApplyCompressed(Texture, CompressedData);
+				}
+				UPackage::SavePackage(Package, Texture, RF_Standalone, *FileName, GLog, nullptr, false, true, SAVE_None);
+				SaveSeconds = FMath::Min(SaveSeconds, FPlatformTime::Seconds() - SaveStartTime);
+
+				const double LoadStartTime = FPlatformTime::Seconds();
+				TArray64<uint8> FileData;
+				TArray64<uint8> MipData;
+				FFileHelper::LoadFileToArray(FileData, *FileName);
+				Texture->Source.GetMipData(MipData, 0, 0, 0);
+				LoadSeconds = FMath::Min(LoadSeconds, FPlatformTime::Seconds() - LoadStartTime);
+				bMatches &= (MipData == Image);
+			}
+
+			Rows += FString::Printf(TEXT("%s,%s,%d,%d,%s,%lld,%.6f,%.6f,%d\n"), *Name, *StaticEnum<ETextureSourceFormat>()->GetNameStringByValue(int64(Format)),
+				Size.X, Size.Y, bCompressed ? TEXT("PNG") : TEXT("Raw"), IFileManager::Get().FileSize(*FileName), SaveSeconds, LoadSeconds, bMatches ? 1 : 0);
+			Texture->ClearFlags(RF_Public | RF_Standalone);
+			IFileManager::Get().Delete(*FileName);
+		}
+		return Rows;
+	}
+
+	static void Run(const TArray<FString>& Args)
+	{
+		TArray<FString> TexturePaths;
+		int32 Iterations = 3;
+		for (const FString& Arg : Args)
+		{
+			if (Arg.StartsWith(TEXT("Iterations=")))
+			{
+				Iterations = FMath::Max(1, FCString::Atoi(*Arg.RightChop(11)));
+			}
+			else
+			{
+				TexturePaths.Add(Arg);
+			}
+		}
+
+		FString Report = TEXT("texture,image_format,width,height,layout,package_bytes,save_seconds,load_seconds,lossless\n");
+		for (const FString& TexturePath : TexturePaths)
+		{
+			UTexture2D* Texture = LoadObject<UTexture2D>(nullptr, *TexturePath);
+			TArray64<uint8> Image;
+			if (!Texture || !Texture->Source.GetMipData(Image, 0, 0, 0))
+			{
+				UE_LOG(LogTexture, Error, TEXT("Source of %s can't be read, skipped"), *TexturePath);
+				continue;
+			}
+			Report += RunCase(Texture->GetName(), FIntPoint(Texture->Source.GetSizeX(), Texture->Source.GetSizeY()), Texture->Source.GetFormat(), Image, Iterations);
+		}
+		if (TexturePaths.Num() == 0)
+		{
+			const ETextureSourceFormat Formats[] = { ETextureSourceFormat::TSF_G8, ETextureSourceFormat::TSF_BGRA8, ETextureSourceFormat::TSF_RGBA16 };
+			for (ETextureSourceFormat Format : Formats)
+			{
+				TArray64<uint8> Image;
+				MakeSyntheticImage(FIntPoint(4096, 4096), Format, Image);
+				Report += RunCase(TEXT("Synthetic"), FIntPoint(4096, 4096), Format, Image, Iterations);
+			}
+		}
+
+		const FString ReportPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("TextureBaker"), FString::Printf(TEXT("SourceCompressionBenchmark-%s.csv"), *FDateTime::Now().ToString()));
+		if (FFileHelper::SaveStringToFile(Report, *ReportPath))
+		{
+			UE_LOG(LogTexture, Display, TEXT("Source compression benchmark written to %s"), *ReportPath);
+		}
+		else
+		{
+			UE_LOG(LogTexture, Error, TEXT("Failed to write source compression benchmark to %s"), *ReportPath);
+		}
+	}
+}
+
+static FAutoConsoleCommand GTextureBakerBenchmarkSourceCompressionCommand(
+	TEXT("TextureBaker.BenchmarkSourceCompression"),
+	TEXT("Saves textures with raw and PNG compressed source art and writes a CSV report of size, save and load time to Saved/TextureBaker. Args: [TexturePath...] [Iterations=N]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&TextureBakerSourceCompressionBenchmark::Run));
+
+static FAutoConsoleCommand GTextureBakerBenchmarkTranscodersCommand(
+	TEXT("TextureBaker.BenchmarkTranscoders"),
+	TEXT("Runs every readback handler over synthetic data and writes a CSV report to Saved/TextureBaker. Args: [Size...] [Iterations=N]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&TextureBakerBenchmark::Run));
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// Transcoder benchmark in the automation framework, so it runs with the other perf tests. Sizes are kept small, the console
+// command is there for full runs
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTextureBakerTranscoderBenchmarkTest, "TextureBaker.Benchmark.Transcoders",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FTextureBakerTranscoderBenchmarkTest::RunTest(const FString& Parameters)
+{
+	return TextureBakerBenchmark::RunBenchmark({ TEXT("256"), TEXT("1024"), TEXT("Iterations=3") });
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,179 @@
+#include "TextureBakerCompression.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/PlatformProcess.h"
+#include "Interfaces/ITargetPlatform.h"
+#include "Interfaces/ITargetPlatformManagerModule.h"
+#include "EngineLogs.h"
+
+static TAutoConsoleVariable<int32> CVarTextureBakerCompressionAtBakeTime(
+	TEXT("TextureBaker.Compression.AtBakeTime"),
+	1,
+	TEXT("Compress baked outputs on worker threads while the bake runs.\n")
+	TEXT(" 0: each output is built synchronously when its source is written\n")
+	TEXT(" 1: outputs are built asynchronously and in parallel, the bake waits for them at the end (default)"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTextureBakerCompressionTargetPlatforms(
+	TEXT("TextureBaker.Compression.TargetPlatforms"),
+	0,
+	TEXT("Also build baked outputs for all active target platforms, so their compressed data is in the DDC before cooking."),
+	ECVF_Default);
+
+static constexpr float CompressionPollInterval = 0.005f;
+
+FTextureBakerCompressionQueue::FTextureBakerCompressionQueue()
+	: BatchStartTime(0.0)
+	, LastFinishTime(0.0)
+	, TotalLatencySeconds(0.0)
+	, NumBuilt(0)
+{
+	if (CVarTextureBakerCompressionTargetPlatforms.GetValueOnGameThread() != 0)
+	{
+		if (ITargetPlatformManagerModule* TargetPlatformManager = GetTargetPlatformManager())
+		{
+			TargetPlatforms = TargetPlatformManager->GetActiveTargetPlatforms();
+		}
+	}
+}
+
+FTextureBakerCompressionQueue::~FTextureBakerCompressionQueue()
+{
+	Finish();
+}
+
+bool FTextureBakerCompressionQueue::IsEnabled()
+{
+	return CVarTextureBakerCompressionAtBakeTime.GetValueOnGameThread() != 0;
+}
+
+void FTextureBakerCompressionQueue::Add(UTexture2D* Texture, bool bIsOutput, TFunction<void(UTexture2D*)> OnBuilt)
+{
+	check(IsInGameThread());
+	if (Texture && !IsPending(Texture))
+	{
+		Texture->BeginCachePlatformData();
+		for (int32 Index = 0; bIsOutput && Index < TargetPlatforms.Num(); Index++)
+		{
+			Texture->BeginCacheForCookedPlatformData(TargetPlatforms[Index]);
+		}
+		const double StartTime = FPlatformTime::Seconds();
+		if (bIsOutput && BatchStartTime == 0.0)
+		{
+			BatchStartTime = StartTime;
+		}
+		PendingBuilds.Add({ TStrongObjectPtr<UTexture2D>(Texture), StartTime, bIsOutput, MoveTemp(OnBuilt) });
+	}
+}
+
+bool FTextureBakerCompressionQueue::IsPending(const UTexture2D* Texture) const
+{
+	return PendingBuilds.ContainsByPredicate([Texture](const FPendingBuild& Build) { return Build.Texture.Get() == Texture; });
+}
+
+bool FTextureBakerCompressionQueue::WaitFor(UTexture2D* Texture)
+{
+	check(IsInGameThread());
+	const int32 Index = PendingBuilds.IndexOfByPredicate([Texture](const FPendingBuild& Build) { return Build.Texture.Get() == Texture; });
+	if (Index == INDEX_NONE)
+	{
+		return false;
+	}
+
+	// Cooked platform data of outputs has to be done too before it's released
+	while (!IsBuildComplete(PendingBuilds[Index]))
+	{
+		FPlatformProcess::Sleep(CompressionPollInterval);
+	}
+	FinishBuild(PendingBuilds[Index]);
+	PendingBuilds.RemoveAt(Index);
+	return true;
+}
+
+bool FTextureBakerCompressionQueue::IsBuildComplete(const FPendingBuild& Build) const
+{
+	if (!Build.Texture->IsAsyncCacheComplete())
+	{
+		return false;
+	}
+	for (int32 Index = 0; Build.bIsOutput && Index < TargetPlatforms.Num(); Index++)
+	{
+		if (!Build.Texture->IsCachedCookedPlatformDataLoaded(TargetPlatforms[Index]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void FTextureBakerCompressionQueue::FinishBuild(const FPendingBuild& Build)
+{
+	UTexture2D* Texture = Build.Texture.Get();
+	Texture->FinishCachePlatformData();
+	// Includes time the build waited for a worker and for the next poll
+	const double FinishTime = FPlatformTime::Seconds();
+	const double LatencySeconds = FinishTime - Build.StartTime;
+
+	// Platform data matches the source now, so this only recreates the resource
+	Texture->UpdateResource();
+	if (Build.OnBuilt)
+	{
+		Build.OnBuilt(Texture);
+	}
+
+	if (Build.bIsOutput)
+	{
+		// Cooked data is in the DDC already, there's no need to keep it in memory
+		for (ITargetPlatform* TargetPlatform : TargetPlatforms)
+		{
+			Texture->ClearCachedCookedPlatformData(TargetPlatform);
+		}
+		TotalLatencySeconds += LatencySeconds;
+		LastFinishTime = FinishTime;
+		NumBuilt++;
+		UE_LOG(LogTexture, Log, TEXT("Compressed %s, %.1f ms after it was queued"), *Texture->GetName(), LatencySeconds * 1000.0);
+	}
+	else
+	{
+		UE_LOG(LogTexture, Verbose, TEXT("Built temporary texture %s, %.1f ms after it was queued"), *Texture->GetName(), LatencySeconds * 1000.0);
+	}
+}
+
+void FTextureBakerCompressionQueue::Tick()
+{
+	check(IsInGameThread());
+	for (int32 Index = 0; Index < PendingBuilds.Num(); Index++)
+	{
+		if (IsBuildComplete(PendingBuilds[Index]))
+		{
+			FinishBuild(PendingBuilds[Index]);
+			PendingBuilds.RemoveAt(Index--);
+		}
+	}
+}
+
+void FTextureBakerCompressionQueue::Finish()
+{
+	if (PendingBuilds.Num() == 0 && NumBuilt == 0)
+	{
+		return;
+	}
+
+	const double WaitStartTime = FPlatformTime::Seconds();
+	Tick();
+	while (PendingBuilds.Num() > 0)
+	{
+		FPlatformProcess::Sleep(CompressionPollInterval);
+		Tick();
+	}
+
+	if (NumBuilt > 0)
+	{
+		UE_LOG(LogTexture, Log, TEXT("Compressed %d baked outputs in %.1f ms wall time, %.1f ms average latency, %.1f ms waited at the end of the bake"),
+			NumBuilt, (LastFinishTime - BatchStartTime) * 1000.0, TotalLatencySeconds * 1000.0 / NumBuilt, (FPlatformTime::Seconds() - WaitStartTime) * 1000.0);
+	}
+	BatchStartTime = 0.0;
+	LastFinishTime = 0.0;
+	TotalLatencySeconds = 0.0;
+	NumBuilt = 0;
+}
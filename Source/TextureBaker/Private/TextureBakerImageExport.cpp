@@ -0,0 +1,252 @@
+#include "TextureBakerImageExport.h"
+#include "Renderer/TextureBakerRenderContext.h"
+#include "Async/Async.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/PlatformTime.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/Paths.h"
+#include "EngineLogs.h"
+
+static TAutoConsoleVariable<int32> CVarTextureBakerExportMaxInFlight(
+	TEXT("TextureBaker.Export.MaxInFlight"),
+	4,
+	TEXT("Maximum number of image file exports encoded and written concurrently. Each one keeps its image in memory until it's written."),
+	ECVF_Default);
+
+static constexpr int64 ExportBandBytes = 4 * 1024 * 1024;
+
+namespace TextureBakerImageExport
+{
+	// DXGI_FORMAT values of the uncompressed layouts
+	static uint32 GetDXGIFormat(ETextureSourceFormat ImageFormat, bool bSRGB)
+	{
+		switch (ImageFormat)
+		{
+		case TSF_G8: return 61;						// R8_UNORM
+		case TSF_G16: return 56;					// R16_UNORM
+		case TSF_BGRA8: return bSRGB ? 91 : 87;		// B8G8R8A8_UNORM(_SRGB)
+		case TSF_RGBA8: return bSRGB ? 29 : 28;		// R8G8B8A8_UNORM(_SRGB)
+		case TSF_RGBA16: return 11;					// R16G16B16A16_UNORM
+		case TSF_RGBA16F: return 10;				// R16G16B16A16_FLOAT
+		}
+		return 0;
+	}
+
+	static bool GetImageWrapperLayout(ETBImageFileFormat FileFormat, ETextureSourceFormat ImageFormat, ERGBFormat& OutRGBFormat, int32& OutBitDepth)
+	{
+		if (FileFormat == ETBImageFileFormat::EXR)
+		{
+			OutRGBFormat = ERGBFormat::RGBA;
+			OutBitDepth = 16;
+			return ImageFormat == TSF_RGBA16F;
+		}
+		switch (ImageFormat)
+		{
+		case TSF_G8: OutRGBFormat = ERGBFormat::Gray; OutBitDepth = 8; return true;
+		case TSF_G16: OutRGBFormat = ERGBFormat::Gray; OutBitDepth = 16; return true;
+		case TSF_BGRA8: OutRGBFormat = ERGBFormat::BGRA; OutBitDepth = 8; return true;
+		case TSF_RGBA8: OutRGBFormat = ERGBFormat::RGBA; OutBitDepth = 8; return true;
+		case TSF_RGBA16: OutRGBFormat = ERGBFormat::RGBA; OutBitDepth = 16; return true;
+		}
+		return false;
+	}
+
+	static bool WriteBands(IFileHandle& File, const uint8* Data, int64 Bytes)
+	{
+		for (int64 Offset = 0; Offset < Bytes; Offset += ExportBandBytes)
+		{
+			if (!File.Write(Data + Offset, FMath::Min(ExportBandBytes, Bytes - Offset)))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static bool WriteCompressed(IFileHandle& File, const FTextureBakerTiledImage& Image, ETBImageFileFormat FileFormat)
+	{
+		ERGBFormat RGBFormat;
+		int32 BitDepth;
+		IImageWrapperModule& ImageWrapperModule = FModuleManager::GetModuleChecked<IImageWrapperModule>("ImageWrapper");
+		TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(FileFormat == ETBImageFileFormat::EXR ? EImageFormat::EXR : EImageFormat::PNG);
+		if (!ImageWrapper.IsValid() || !GetImageWrapperLayout(FileFormat, Image.Format, RGBFormat, BitDepth)
+			|| !ImageWrapper->SetRaw(Image.Data.GetData(), Image.Data.Num(), Image.Size.X, Image.Size.Y, RGBFormat, BitDepth))
+		{
+			return false;
+		}
+		const TArray64<uint8>& Compressed = ImageWrapper->GetCompressed();
+		return Compressed.Num() > 0 && WriteBands(File, Compressed.GetData(), Compressed.Num());
+	}
+
+	static bool WriteTGA(IFileHandle& File, const FTextureBakerTiledImage& Image)
+	{
+		const bool bGray = (Image.Format == TSF_G8);
+		const uint8 Header[18] = {
+			0, 0, uint8(bGray ? 3 : 2), 0, 0, 0, 0, 0, 0, 0, 0, 0,
+			uint8(Image.Size.X & 0xFF), uint8(Image.Size.X >> 8), uint8(Image.Size.Y & 0xFF), uint8(Image.Size.Y >> 8),
+			uint8(bGray ? 8 : 32), uint8(bGray ? 0x20 : 0x28)	// Top-left origin, 8 alpha bits for BGRA
+		};
+		if (!File.Write(Header, sizeof(Header)))
+		{
+			return false;
+		}
+		if (Image.Format != TSF_RGBA8)
+		{
+			return WriteBands(File, Image.Data.GetData(), Image.Data.Num());
+		}
+
+		// TGA stores BGRA, rows are swizzled band by band
+		const int64 RowBytes = int64(Image.Size.X) * 4;
+		const int32 RowsPerBand = FMath::Max<int32>(1, int32(ExportBandBytes / RowBytes));
+		TArray64<uint8> Band;
+		for (int32 FirstRow = 0; FirstRow < Image.Size.Y; FirstRow += RowsPerBand)
+		{
+			const int32 NumRows = FMath::Min(RowsPerBand, Image.Size.Y - FirstRow);
+			const uint8* Source = Image.Data.GetData() + FirstRow * RowBytes;
+			Band.SetNumUninitialized(NumRows * RowBytes, false);
+			for (int64 Offset = 0; Offset < Band.Num(); Offset += 4)
+			{
+				Band[Offset + 0] = Source[Offset + 2];
+				Band[Offset + 1] = Source[Offset + 1];
+				Band[Offset + 2] = Source[Offset + 0];
+				Band[Offset + 3] = Source[Offset + 3];
+			}
+			if (!File.Write(Band.GetData(), Band.Num()))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static bool WriteDDS(IFileHandle& File, const FTextureBakerTiledImage& Image)
+	{
+		// Magic, DDS_HEADER and DDS_HEADER_DXT10. Pixel format is always described by the DX10 extension
+		uint32 Header[1 + 31 + 5] = {};
+		Header[0] = 0x20534444;											// "DDS "
+		Header[1] = 124;												// dwSize
+		Header[2] = 0x1 | 0x2 | 0x4 | 0x8 | 0x1000;						// CAPS | HEIGHT | WIDTH | PITCH | PIXELFORMAT
+		Header[3] = Image.Size.Y;
+		Header[4] = Image.Size.X;
+		Header[5] = Image.Size.X * FTextureSource::GetBytesPerPixel(Image.Format);
+		Header[19] = 32;												// ddspf.dwSize
+		Header[20] = 0x4;												// DDPF_FOURCC
+		Header[21] = 0x30315844;										// "DX10"
+		Header[27] = 0x1000;											// DDSCAPS_TEXTURE
+		Header[32] = GetDXGIFormat(Image.Format, Image.bSRGB);
+		Header[33] = 3;													// D3D10_RESOURCE_DIMENSION_TEXTURE2D
+		Header[35] = 1;													// arraySize
+		return File.Write(reinterpret_cast<const uint8*>(Header), sizeof(Header)) && WriteBands(File, Image.Data.GetData(), Image.Data.Num());
+	}
+}
+
+FTextureBakerImageExporter::~FTextureBakerImageExporter()
+{
+	Finish();
+}
+
+bool FTextureBakerImageExporter::SupportsFormat(ETBImageFileFormat FileFormat, ETextureSourceFormat ImageFormat)
+{
+	ERGBFormat RGBFormat;
+	int32 BitDepth;
+	switch (FileFormat)
+	{
+	case ETBImageFileFormat::PNG:
+	case ETBImageFileFormat::EXR:
+		return TextureBakerImageExport::GetImageWrapperLayout(FileFormat, ImageFormat, RGBFormat, BitDepth);
+	case ETBImageFileFormat::TGA:
+		return ImageFormat == TSF_G8 || ImageFormat == TSF_BGRA8 || ImageFormat == TSF_RGBA8;
+	case ETBImageFileFormat::DDS:
+		return TextureBakerImageExport::GetDXGIFormat(ImageFormat, false) != 0;
+	}
+	return false;
+}
+
+const TCHAR* FTextureBakerImageExporter::GetFileExtension(ETBImageFileFormat FileFormat)
+{
+	switch (FileFormat)
+	{
+	case ETBImageFileFormat::PNG: return TEXT(".png");
+	case ETBImageFileFormat::EXR: return TEXT(".exr");
+	case ETBImageFileFormat::TGA: return TEXT(".tga");
+	case ETBImageFileFormat::DDS: return TEXT(".dds");
+	}
+	return TEXT("");
+}
+
+bool FTextureBakerImageExporter::WriteImageFile(const FTextureBakerTiledImage& Image, ETBImageFileFormat FileFormat, const FString& FileName)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	TUniquePtr<IFileHandle> File(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*FileName));
+	bool bWritten = false;
+	if (File.IsValid())
+	{
+		switch (FileFormat)
+		{
+		case ETBImageFileFormat::PNG:
+		case ETBImageFileFormat::EXR:
+			bWritten = TextureBakerImageExport::WriteCompressed(*File, Image, FileFormat);
+			break;
+		case ETBImageFileFormat::TGA:
+			bWritten = TextureBakerImageExport::WriteTGA(*File, Image);
+			break;
+		case ETBImageFileFormat::DDS:
+			bWritten = TextureBakerImageExport::WriteDDS(*File, Image);
+			break;
+		}
+		bWritten &= File->Flush();
+	}
+
+	if (bWritten)
+	{
+		UE_LOG(LogTexture, Log, TEXT("Exported %s in %.1f ms"), *FileName, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	}
+	else
+	{
+		UE_LOG(LogTexture, Error, TEXT("Failed to export %s"), *FileName);
+	}
+	return bWritten;
+}
+
+void FTextureBakerImageExporter::Export(TSharedRef<const FTextureBakerTiledImage> Image, ETBImageFileFormat FileFormat, const FString& FileName)
+{
+	check(IsInGameThread());
+	if (!SupportsFormat(FileFormat, Image->Format))
+	{
+		UE_LOG(LogTexture, Error, TEXT("Can't export %s, image format isn't supported by the file format"), *FileName);
+		NumFailed++;
+		return;
+	}
+
+	// Module loading and directory creation aren't left to worker threads
+	FModuleManager::LoadModuleChecked<IImageWrapperModule>("ImageWrapper");
+	FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*FPaths::GetPath(FileName));
+
+	while (PendingExports.Num() >= FMath::Max(1, CVarTextureBakerExportMaxInFlight.GetValueOnGameThread()))
+	{
+		WaitForOldest();
+	}
+	PendingExports.Add(Async(EAsyncExecution::ThreadPool, [Image, FileFormat, FileName]()
+	{
+		return WriteImageFile(*Image, FileFormat, FileName);
+	}));
+}
+
+void FTextureBakerImageExporter::WaitForOldest()
+{
+	NumFailed += PendingExports[0].Get() ? 0 : 1;
+	PendingExports.RemoveAt(0);
+}
+
+int32 FTextureBakerImageExporter::Finish()
+{
+	while (PendingExports.Num() > 0)
+	{
+		WaitForOldest();
+	}
+	const int32 Result = NumFailed;
+	NumFailed = 0;
+	return Result;
+}
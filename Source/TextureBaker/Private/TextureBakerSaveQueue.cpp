@@ -0,0 +1,109 @@
+#include "TextureBakerSaveQueue.h"
+#include "TextureBakerCompression.h"
+#include "TextureBakerSourceCompression.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "AssetRegistryModule.h"
+#include "UObject/Package.h"
+#include "EngineLogs.h"
+
+static TAutoConsoleVariable<int32> CVarTextureBakerSaveBatched(
+	TEXT("TextureBaker.Save.Batched"),
+	1,
+	TEXT("Save baked outputs in batches with asynchronous file writes and a single asset registry update.\n")
+	TEXT(" 0: each output is saved synchronously as soon as it's baked\n")
+	TEXT(" 1: batched saving (default)"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTextureBakerSaveBatchSize(
+	TEXT("TextureBaker.Save.BatchSize"),
+	16,
+	TEXT("Number of baked outputs queued before their packages are serialized. Texture builds of outputs start once they're saved."),
+	ECVF_Default);
+
+FTextureBakerSaveQueue::FTextureBakerSaveQueue(FTextureBakerCompressionQueue* InCompressionQueue)
+	: CompressionQueue(InCompressionQueue)
+	, PrepareSeconds(0.0)
+	, SerializeSeconds(0.0)
+	, NumFailed(0)
+{
+}
+
+FTextureBakerSaveQueue::~FTextureBakerSaveQueue()
+{
+	Finish();
+}
+
+bool FTextureBakerSaveQueue::IsEnabled()
+{
+	return CVarTextureBakerSaveBatched.GetValueOnGameThread() != 0;
+}
+
+void FTextureBakerSaveQueue::Add(UPackage* Package, UTexture2D* Texture, const FString& PackageFileName, double InPrepareSeconds, TFuture<TArray64<uint8>> CompressedSource)
+{
+	check(IsInGameThread());
+	QueuedPackages.Add({ TStrongObjectPtr<UPackage>(Package), TStrongObjectPtr<UTexture2D>(Texture), PackageFileName, MoveTemp(CompressedSource) });
+	PrepareSeconds += InPrepareSeconds;
+	if (QueuedPackages.Num() >= FMath::Max(1, CVarTextureBakerSaveBatchSize.GetValueOnGameThread()))
+	{
+		Flush();
+	}
+}
+
+void FTextureBakerSaveQueue::Flush()
+{
+	check(IsInGameThread());
+	for (FQueuedPackage& Queued : QueuedPackages)
+	{
+		// Package is serialized to memory here, the file is written on a background thread. Source encoding had the whole batch to finish
+		const double StartTime = FPlatformTime::Seconds();
+		if (Queued.CompressedSource.IsValid())
+		{
+			TextureBakerSourceCompression::ApplyCompressed(Queued.Texture.Get(), Queued.CompressedSource);
+		}
+		const bool bSaved = UPackage::SavePackage(Queued.Package.Get(), Queued.Texture.Get(), RF_Standalone, *Queued.PackageFileName, GLog, nullptr, false, true, SAVE_Async);
+		SerializeSeconds += FPlatformTime::Seconds() - StartTime;
+		if (bSaved)
+		{
+			SavedFiles.Add(Queued.PackageFileName);
+		}
+		else
+		{
+			NumFailed++;
+		}
+
+		// Source is saved, the build can read it on worker threads while the next outputs are baked
+		if (CompressionQueue)
+		{
+			CompressionQueue->Add(Queued.Texture.Get());
+		}
+	}
+	QueuedPackages.Reset();
+}
+
+void FTextureBakerSaveQueue::Finish()
+{
+	Flush();
+	if (SavedFiles.Num() == 0 && NumFailed == 0)
+	{
+		return;
+	}
+
+	const double WriteStartTime = FPlatformTime::Seconds();
+	UPackage::WaitForAsyncFileWrites();
+	const double WriteSeconds = FPlatformTime::Seconds() - WriteStartTime;
+
+	// One scan picks up new and overwritten assets of the whole bake
+	const double RegistryStartTime = FPlatformTime::Seconds();
+	FAssetRegistryModule& AssetRegistryModule = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry");
+	AssetRegistryModule.Get().ScanModifiedAssetFiles(SavedFiles);
+	const double RegistrySeconds = FPlatformTime::Seconds() - RegistryStartTime;
+
+	UE_LOG(LogTexture, Log, TEXT("Saved %d baked outputs (%d failed): prepare %.1f ms, serialize %.1f ms, file write wait %.1f ms, asset registry %.1f ms"),
+		SavedFiles.Num(), NumFailed, PrepareSeconds * 1000.0, SerializeSeconds * 1000.0, WriteSeconds * 1000.0, RegistrySeconds * 1000.0);
+
+	SavedFiles.Reset();
+	PrepareSeconds = 0.0;
+	SerializeSeconds = 0.0;
+	NumFailed = 0;
+}
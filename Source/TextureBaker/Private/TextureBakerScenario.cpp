@@ -65,9 +65,8 @@ UTexture2D* UTextureBakerScenario::PrepareTexture(UTexture2D* SourceTexture, con
 	UTexture2D* Result = nullptr;
 	if (CurrentRenderScope.IsValid() && SourceTexture)
 	{
-		FIntPoint ImportedSize = SourceTexture->GetImportedSize();
-		FIntPoint CurrentSize = FIntPoint(SourceTexture->GetSizeX(), SourceTexture->GetSizeY());
 		Result = CurrentRenderScope->ConditionallyCreateDerivedArt(SourceTexture, Options);
+		CurrentRenderScope->WaitForTexture(Result);
 		CurrentRenderScope->SetTextureMipsResident(Result, true);
 	}
 	if (Result)
@@ -77,6 +76,32 @@ UTexture2D* UTextureBakerScenario::PrepareTexture(UTexture2D* SourceTexture, con
 	return Result;
 }
 
+TArray<UTexture2D*> UTextureBakerScenario::PrepareTextures(const TArray<UTexture2D*>& SourceTextures, const FTextureBakerResourceRequirements& Options)
+{
+	TArray<UTexture2D*> Results;
+	if (CurrentRenderScope.IsValid())
+	{
+		// All derived art is requested first, so deferred builds run side by side
+		for (UTexture2D* SourceTexture : SourceTextures)
+		{
+			Results.Add(SourceTexture ? CurrentRenderScope->ConditionallyCreateDerivedArt(SourceTexture, Options) : nullptr);
+		}
+		for (UTexture2D* Result : Results)
+		{
+			CurrentRenderScope->WaitForTexture(Result);
+			CurrentRenderScope->SetTextureMipsResident(Result, true);
+		}
+		for (UTexture2D* Result : Results)
+		{
+			if (Result)
+			{
+				Result->WaitForStreaming();
+			}
+		}
+	}
+	return Results;
+}
+
 UMaterialInterface* UTextureBakerScenario::PrepareMaterial(UMaterialInterface* SourceMaterial)
 {
 	if (CurrentRenderScope.IsValid() && SourceMaterial)
@@ -86,6 +111,7 @@ UMaterialInterface* UTextureBakerScenario::PrepareMaterial(UMaterialInterface* S
 		for (int32 TextureIndex = 0; TextureIndex < Textures.Num(); ++TextureIndex)
 		{
 			UTexture2D* Texture = Cast<UTexture2D>(Textures[TextureIndex]);
+			CurrentRenderScope->WaitForTexture(Texture);
 			CurrentRenderScope->SetTextureMipsResident(Texture, true);
 		}
 	}
@@ -102,6 +128,7 @@ UMaterialInstanceDynamic* UTextureBakerScenario::PrepareDynamicMaterialInstance(
 		for (int32 TextureIndex = 0; TextureIndex < Textures.Num(); ++TextureIndex)
 		{
 			UTexture2D* Texture = Cast<UTexture2D>(Textures[TextureIndex]);
+			CurrentRenderScope->WaitForTexture(Texture);
 			CurrentRenderScope->SetTextureMipsResident(Texture, true);
 		}
 		return DMI;
@@ -128,7 +155,8 @@ UTexture2D* UTextureBakerScenario::DownsampleTexture(UTexture2D* SourceTexture,
 {
 	if (CurrentRenderScope.IsValid() && SourceTexture)
 	{
-		const FIntPoint TargetSize = EvaluateRequestedSize(SourceTexture->GetImportedSize(), MipIndex);
+		// Prepared textures may have released their source, the imported size is the one of their original
+		const FIntPoint TargetSize = EvaluateRequestedSize(CurrentRenderScope->GetDerivedArtOriginal(SourceTexture)->GetImportedSize(), MipIndex);
 		FTextureBakerOutputInfo DownsampledInfo(SourceTexture, TargetSize);
 		return MipIndex > 0 ? CurrentRenderScope->CreateTemporaryTexture(DownsampledInfo, ETextureSourceFormat::TSF_Invalid, nullptr) : SourceTexture;
 	}
@@ -0,0 +1,72 @@
+#include "TextureBakerSourceCompression.h"
+#include "Async/Async.h"
+#include "Engine/Texture2D.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "EngineLogs.h"
+
+namespace TextureBakerSourceCompression
+{
+	// Same channel layout FTextureSource requests when it decodes PNG source
+	static bool GetPNGLayout(ETextureSourceFormat Format, ERGBFormat& OutRGBFormat, int32& OutBitDepth)
+	{
+		switch (Format)
+		{
+		case TSF_G8: OutRGBFormat = ERGBFormat::Gray; OutBitDepth = 8; return true;
+		case TSF_BGRA8: OutRGBFormat = ERGBFormat::BGRA; OutBitDepth = 8; return true;
+		case TSF_RGBA8: OutRGBFormat = ERGBFormat::RGBA; OutBitDepth = 8; return true;
+		case TSF_RGBA16: OutRGBFormat = ERGBFormat::RGBA; OutBitDepth = 16; return true;
+		}
+		return false;
+	}
+
+	bool CanCompress(const FTextureSource& Source)
+	{
+		ERGBFormat RGBFormat;
+		int32 BitDepth;
+		return Source.GetNumMips() == 1 && Source.GetNumSlices() == 1 && GetPNGLayout(Source.GetFormat(), RGBFormat, BitDepth);
+	}
+
+	TFuture<TArray64<uint8>> BeginCompress(const FTextureSource& Source, const void* ImageData)
+	{
+		check(IsInGameThread());
+		ERGBFormat RGBFormat;
+		int32 BitDepth;
+		IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>("ImageWrapper");
+		TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+		const int64 ImageBytes = int64(Source.GetBytesPerPixel()) * Source.GetSizeX() * Source.GetSizeY();
+		if (!ImageData || !ImageWrapper.IsValid() || !GetPNGLayout(Source.GetFormat(), RGBFormat, BitDepth)
+			|| !ImageWrapper->SetRaw(ImageData, ImageBytes, Source.GetSizeX(), Source.GetSizeY(), RGBFormat, BitDepth))
+		{
+			return MakeFulfilledPromise<TArray64<uint8>>().GetFuture();
+		}
+
+		// SetRaw took its own copy, the caller's buffer is free to go
+		return Async(EAsyncExecution::ThreadPool, [ImageWrapper]()
+		{
+			return TArray64<uint8>(ImageWrapper->GetCompressed());
+		});
+	}
+
+	bool ApplyCompressed(UTexture2D* Texture, TFuture<TArray64<uint8>>& CompressedData)
+	{
+		check(Texture && CompressedData.IsValid());
+		TArray64<uint8> Data = CompressedData.Get();
+		CompressedData.Reset();
+
+		FTextureSource& Source = Texture->Source;
+		const int64 RawBytes = int64(Source.GetBytesPerPixel()) * Source.GetSizeX() * Source.GetSizeY();
+		if (Data.Num() == 0 || !CanCompress(Source))
+		{
+			UE_LOG(LogTexture, Warning, TEXT("Couldn't compress source of %s, it's stored raw"), *Texture->GetName());
+			return false;
+		}
+
+		// Same pixels, so the source id and the built platform data stay valid
+		const FGuid SourceId = Source.GetId();
+		Source.InitWithCompressedSourceData(Source.GetSizeX(), Source.GetSizeY(), 1, Source.GetFormat(), Data, TSCF_PNG);
+		Source.SetId(SourceId, false);
+		UE_LOG(LogTexture, Verbose, TEXT("Compressed source of %s, %.2f MB to %.2f MB"), *Texture->GetName(), RawBytes / (1024.0 * 1024.0), Data.Num() / (1024.0 * 1024.0));
+		return true;
+	}
+}
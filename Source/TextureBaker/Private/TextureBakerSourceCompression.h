@@ -0,0 +1,20 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+
+class UTexture2D;
+class FTextureSource;
+
+// Lossless PNG storage of baked source art. Only layouts FTextureSource can decompress from PNG are supported: a single
+// G8, BGRA8, RGBA8 or RGBA16 mip. HDR sources have no lossless codec there and stay raw
+namespace TextureBakerSourceCompression
+{
+	bool CanCompress(const FTextureSource& Source);
+
+	// Image is laid out as mip 0 of Source and is copied before returning, encoding runs on a worker thread
+	TFuture<TArray64<uint8>> BeginCompress(const FTextureSource& Source, const void* ImageData);
+
+	// Waits for the encoded data and replaces the raw source with it. The raw source is kept if encoding failed
+	bool ApplyCompressed(UTexture2D* Texture, TFuture<TArray64<uint8>>& CompressedData);
+}
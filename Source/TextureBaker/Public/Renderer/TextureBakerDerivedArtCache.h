@@ -0,0 +1,83 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+// Uncompressed source mips of derived art read back from the cache. Data is memory mapped when the platform allows it, read into memory otherwise
+class TEXTUREBAKER_API FTextureBakerCachedSourceArt
+{
+public:
+	FTextureBakerCachedSourceArt();
+	~FTextureBakerCachedSourceArt();
+
+	bool Matches(const FTextureSource& SourceArt) const;
+	const uint8* GetData() const { return Data; }
+	void Reset();
+
+private:
+	friend class FTextureBakerDerivedArtCache;
+
+	FIntPoint							Size;
+	int32								NumMips;
+	ETextureSourceFormat				Format;
+	const uint8*						Data;
+	TUniquePtr<IMappedFileHandle>		MappedFile;
+	TUniquePtr<IMappedFileRegion>		MappedRegion;
+	TArray64<uint8>						StreamedData;
+};
+
+// Keeps uncompressed source art of derived art in Saved/TextureBaker/DerivedArt across editor sessions, keyed by content hash, together with
+// content hashes of known sources keyed by their source Id. A known source doesn't have to be locked, which decompresses its bulk data, to get
+// derived art. Files beyond TextureBaker.DerivedArtCache.SizeMB are deleted, least recently used first. Thread safe
+class TEXTUREBAKER_API FTextureBakerDerivedArtCache
+{
+public:
+	FTextureBakerDerivedArtCache();
+	~FTextureBakerDerivedArtCache();
+
+	bool FindContentHash(const FGuid& SourceId, FGuid& OutContentHash) const;
+	void AddContentHash(const FGuid& SourceId, const FGuid& ContentHash);
+
+	// Returns false if there's no cached source art with this content hash
+	bool LoadSourceArt(const FGuid& ContentHash, FTextureBakerCachedSourceArt& OutSourceArt);
+	// SourceData is the locked first mip of SourceArt, all of its mips are written. Every call counts as a miss, the source had to be locked
+	void StoreSourceArt(const FGuid& ContentHash, const FTextureSource& SourceArt, const uint8* SourceData);
+
+	// Writes the content hash index, it's also written on destruction
+	void Flush();
+	void ResetStats();
+
+	int32 GetNumHits() const { return NumHits; }
+	int32 GetNumMisses() const { return NumMisses; }
+	int32 GetNumEvicted() const { return NumEvicted; }
+	int64 GetCachedBytes() const { return CachedBytes; }
+
+	// False if derived art is built from the source every time, see TextureBaker.DerivedArtCache.Enable
+	static bool IsEnabled();
+	// MD5 of all mips of locked source data
+	static FGuid CalcContentHash(const FTextureSource& SourceArt, const uint8* SourceData);
+
+private:
+	struct FCacheEntry
+	{
+		int64 Bytes;
+		FDateTime LastUse;
+	};
+
+	FString GetCacheDirectory() const;
+	FString GetSourceArtFileName(const FGuid& ContentHash) const;
+	void Trim(int64 BudgetBytes);
+	void LoadContentHashes();
+
+	mutable FCriticalSection	Lock;
+	TMap<FGuid, FGuid>			ContentHashes;
+	TMap<FGuid, FCacheEntry>	Entries;
+	int64						CachedBytes;
+	int32						NumHits;
+	int32						NumMisses;
+	int32						NumEvicted;
+	bool						bContentHashesDirty;
+};
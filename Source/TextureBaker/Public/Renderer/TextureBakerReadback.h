@@ -0,0 +1,128 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SharedPointer.h"
+#include "Engine/TextureRenderTarget2D.h"
+
+class FRHIGPUMemoryReadback;
+class FTextureBakerSurfaceReadback;
+struct FTextureBakerEncodeSettings;
+
+typedef TSharedRef<FRHIGPUMemoryReadback, ESPMode::ThreadSafe> FTextureBakerStagingReadbackRef;
+
+// Per channel value range of a baked surface, reduced on the GPU before the surface is encoded
+struct FTextureBakerImageStats
+{
+	FTextureBakerImageStats() : Min(ForceInitToZero), Max(ForceInitToZero), bValid(false) {}
+
+	FLinearColor Min;
+	FLinearColor Max;
+	bool bValid;
+};
+
+// Staging readbacks reused by successive GPU -> CPU copies of a render context
+class TEXTUREBAKER_API FTextureBakerReadbackPool : public TSharedFromThis<FTextureBakerReadbackPool, ESPMode::ThreadSafe>
+{
+public:
+	FTextureBakerReadbackPool() : NumInFlight(0) {}
+
+	// Texture readbacks copy surfaces as is. Their staging texture is created by the first copy and kept, so they're reused only for
+	// surfaces of the same size and format
+	FTextureBakerStagingReadbackRef AcquireTextureReadback(const FIntPoint& Size, EPixelFormat Format);
+	void ReleaseTextureReadback(FTextureBakerStagingReadbackRef Readback, const FIntPoint& Size, EPixelFormat Format);
+
+	// Buffer readbacks copy images encoded on the GPU, their staging buffer follows the size of each copy
+	FTextureBakerStagingReadbackRef AcquireBufferReadback();
+	void ReleaseBufferReadback(FTextureBakerStagingReadbackRef Readback);
+
+	int32 GetNumInFlight() const { return NumInFlight; }
+
+private:
+	struct FFreeTextureReadback
+	{
+		FIntPoint Size;
+		EPixelFormat Format;
+		FTextureBakerStagingReadbackRef Readback;
+	};
+
+	FCriticalSection							PoolLock;
+	TArray<FFreeTextureReadback>				FreeTextureReadbacks;
+	TArray<FTextureBakerStagingReadbackRef>		FreeBufferReadbacks;
+	int32										NumInFlight;
+};
+
+// Host buffers for readback data, reused across all outputs of a bake. Buffers are grouped in power of two size classes,
+// free ones are kept while the retained total stays under TextureBaker.Readback.ArenaMaxMB. Game thread only.
+class TEXTUREBAKER_API FTextureBakerReadbackArena
+{
+public:
+	FTextureBakerReadbackArena() : AllocatedBytes(0), PeakBytes(0), NumAllocations(0), NumReuses(0) {}
+	~FTextureBakerReadbackArena();
+
+	// Returned buffer holds at least Size bytes and stays valid until released
+	void* Acquire(uint64 Size);
+	void Release(void* Buffer);
+
+	// Frees all retained buffers, buffers in use stay valid
+	void Trim();
+
+	uint64 GetPeakBytes() const { return PeakBytes; }
+	int32 GetNumAllocations() const { return NumAllocations; }
+	int32 GetNumReuses() const { return NumReuses; }
+
+private:
+	static constexpr int32 NumSizeClasses = 64;
+	static int32 GetSizeClass(uint64 Size);
+	static uint64 GetClassSize(int32 SizeClass) { return uint64(1) << SizeClass; }
+	void FreeRetainedBuffers(uint64 BytesToFree);
+
+	TMap<void*, int32>		BuffersInUse;
+	TArray<void*>			FreeBuffers[NumSizeClasses];
+	uint64					AllocatedBytes;
+	uint64					PeakBytes;
+	int32					NumAllocations;
+	int32					NumReuses;
+};
+
+// Copy of render target content into a CPU readable staging texture. Copy is enqueued without waiting for the GPU,
+// the game thread blocks only when the data is resolved.
+class TEXTUREBAKER_API FTextureBakerPendingReadback
+{
+public:
+	FTextureBakerPendingReadback(TSharedRef<FTextureBakerReadbackPool, ESPMode::ThreadSafe> Pool, UTextureRenderTarget2D* SourceRT);
+
+	// Encodes surface to the image layout on the GPU first, the readback is the final image data
+	FTextureBakerPendingReadback(TSharedRef<FTextureBakerReadbackPool, ESPMode::ThreadSafe> Pool, UTextureRenderTarget2D* SourceRT, const FTextureBakerEncodeSettings& EncodeSettings);
+	~FTextureBakerPendingReadback();
+
+	bool IsValid() const { return StagingReadback.IsValid(); }
+	bool IsReady() const;
+	bool IsEncodedAs(ETextureSourceFormat ImageFormat) const { return EncodedFormat != ETextureSourceFormat::TSF_Invalid && EncodedFormat == ImageFormat; }
+	EPixelFormat GetSurfaceFormat() const { return SurfaceFormat; }
+	const FIntPoint& GetSize() const { return Size; }
+
+	// Waits for the copy and converts staging data to the handler readback layout. Returns false if handler can't consume
+	// this surface format, DestBuffer is left untouched and the caller has to use the regular ReadbackBuffer then.
+	bool Resolve(const FTextureBakerSurfaceReadback& Handler, void* DestBuffer);
+
+	// Waits for the encoded image and copies it to DestBuffer, which has to hold at least the whole image. Returns false if the encode pass
+	// didn't run, the caller has to read the surface itself then
+	bool ResolveEncoded(void* DestBuffer, uint64 DestBufferSize);
+
+	// Image range, available once the encoded image is resolved if the range was requested by encode settings
+	const FTextureBakerImageStats& GetImageStats() const { return ImageStats; }
+
+private:
+	void ReleaseStaging();
+
+	TSharedRef<FTextureBakerReadbackPool, ESPMode::ThreadSafe>			OwnerPool;
+	TSharedPtr<FRHIGPUMemoryReadback, ESPMode::ThreadSafe>				StagingReadback;
+	TSharedPtr<FRHIGPUMemoryReadback, ESPMode::ThreadSafe>				RangeReadback;
+	// Set on the render thread once copies to the staging readbacks are enqueued
+	TSharedRef<bool, ESPMode::ThreadSafe>								bCopyEnqueued;
+	FTextureBakerImageStats												ImageStats;
+	EPixelFormat														SurfaceFormat;
+	FIntPoint															Size;
+	ETextureSourceFormat												EncodedFormat;
+	uint64																EncodedBytes;
+};
@@ -4,26 +4,80 @@
 #include "TextureBakerScenario.h"
 #include "Templates/SharedPointer.h"
 #include "Renderer/TextureBakerRenderScope.h"
+#include "Renderer/TextureBakerReadback.h"
+#include "Renderer/TextureBakerResourceCache.h"
+#include "TextureBakerCompression.h"
 
 class UTexture2D;
 
+// Output rendered tile by tile. Tiles are stitched into the final image as they are read back, either into its own Data or into
+// memory of the destination, e.g. a locked texture source, so the image isn't copied again
+struct TEXTUREBAKER_API FTextureBakerTiledImage
+{
+	FTextureBakerTiledImage(const FIntPoint& InSize, ETextureSourceFormat InFormat, bool bAllocateData = true);
+
+	// ExternalData has to hold the whole image and stay valid while tiles are written
+	void SetExternalData(void* InExternalData) { ExternalData = static_cast<uint8*>(InExternalData); }
+	uint8* GetData() { return ExternalData ? ExternalData : Data.GetData(); }
+
+	void WriteTile(const FIntRect& TileRect, const void* TileData);
+	void FillTile(const FIntRect& TileRect, const void* PixelData);
+	void AddTileStats(const FTextureBakerImageStats& TileStats);
+
+	FIntPoint Size;
+	ETextureSourceFormat Format;
+	bool bSRGB;
+	TArray64<uint8> Data;
+	uint8* ExternalData;
+	FTextureBakerImageStats Stats;
+};
+
+// Renders tiles of an output into the given image, false if a tile couldn't be rendered
+typedef TFunction<bool(FTextureBakerTiledImage&)> FTextureBakerTileRenderer;
+
 struct TEXTUREBAKER_API FTextureBakerRenderResult
 {
 public:
 	FTextureBakerRenderResult() : ResolvedTexture(nullptr) {}
 	FTextureBakerRenderResult(const FTextureBakerOutputInfo& Info, const FString& Path) : AssetPackagePath(Path), BakerInfo(Info), ResolvedTexture(nullptr) {}
-	FTextureBakerRenderResult(const FTextureBakerOutputInfo& Info, const FString& Path, UTextureRenderTarget2D* ResolvedData) : AssetPackagePath(Path), BakerInfo(Info), ResolvedTexture(ResolvedData) {}
-	FTextureBakerRenderResult(const FTextureBakerRenderResult& Lhs) : AssetPackagePath(Lhs.AssetPackagePath), BakerInfo(Lhs.BakerInfo), ResolvedTexture(Lhs.ResolvedTexture) {}
+	FTextureBakerRenderResult(const FTextureBakerOutputInfo& Info, const FString& Path, UTextureRenderTarget2D* ResolvedData, TSharedPtr<FTextureBakerPendingReadback> Readback = nullptr) : AssetPackagePath(Path), BakerInfo(Info), ResolvedTexture(ResolvedData), PendingReadback(Readback) {}
+	FTextureBakerRenderResult(const FTextureBakerOutputInfo& Info, const FString& Path, TSharedPtr<FTextureBakerTiledImage> Image, FTextureBakerTileRenderer Renderer) : AssetPackagePath(Path), BakerInfo(Info), ResolvedTexture(nullptr), TiledImage(Image), TileRenderer(Renderer) {}
+	FTextureBakerRenderResult(const FTextureBakerRenderResult& Lhs) : AssetPackagePath(Lhs.AssetPackagePath), BakerInfo(Lhs.BakerInfo), ResolvedTexture(Lhs.ResolvedTexture), PendingReadback(Lhs.PendingReadback), TiledImage(Lhs.TiledImage), TileRenderer(Lhs.TileRenderer) {}
 
-	bool IsValid() const { return ResolvedTexture != nullptr && FPaths::ValidatePath(AssetPackagePath) && BakerInfo.IsValid(); }
+	bool IsValid() const { return (ResolvedTexture != nullptr || IsTiled()) && FPaths::ValidatePath(AssetPackagePath) && BakerInfo.IsValid(); }
 	const FTextureBakerOutputInfo& GetInfo() const { return BakerInfo; }
 	UTextureRenderTarget2D* GetTextureRenderTarget() const { return ResolvedTexture; }
 	FString GetPackagePath() const { return AssetPackagePath; }
+	FTextureBakerPendingReadback* GetPendingReadback() const { return PendingReadback.Get(); }
+
+	// Tiled outputs are rendered only once their destination is known, in the render scope they were baked in
+	bool IsTiled() const { return TiledImage.IsValid() && TileRenderer; }
+	TSharedPtr<FTextureBakerTiledImage> GetTiledImage() const { return TiledImage; }
+	bool RenderTiles() const { return IsTiled() && TileRenderer(*TiledImage); }
+
+	// Range of the baked surface reduced on the GPU. Valid only after the result was saved through the encoded readback
+	bool GetImageStats(FTextureBakerImageStats& OutStats) const
+	{
+		if (TiledImage.IsValid() && TiledImage->Stats.bValid)
+		{
+			OutStats = TiledImage->Stats;
+			return true;
+		}
+		if (PendingReadback.IsValid() && PendingReadback->GetImageStats().bValid)
+		{
+			OutStats = PendingReadback->GetImageStats();
+			return true;
+		}
+		return false;
+	}
 
 protected:
 	FString AssetPackagePath;
 	FTextureBakerOutputInfo BakerInfo;
 	UTextureRenderTarget2D* ResolvedTexture;
+	TSharedPtr<FTextureBakerPendingReadback> PendingReadback;
+	TSharedPtr<FTextureBakerTiledImage> TiledImage;
+	FTextureBakerTileRenderer TileRenderer;
 };
 
 class TEXTUREBAKER_API FTextureBakerRenderContext : public FGCObject, public ITextureBakerRTPool
@@ -40,18 +94,34 @@ public:
 	FTextureBakerRenderResult BakeOutput(FName OutputToBake);
 
 	const TSet<FName>& GetOutputsToBake() const { return OutputsToRender; }
+
+	// Number of baked outputs which may wait for the readback while next outputs are rendered. 1 disables pipelining
+	int32 GetMaxReadbacksInFlight() const;
+
+	// Pools shared with other render contexts
+	FTextureBakerResourceCache& GetResourceCache() const { return *ResourceCache; }
+	// Peak memory of temporary render targets if each kept its own memory until its scope ended, and if only ones in use at the same time did
+	void GetTransientPeakBytes(int64& OutUnaliasedBytes, int64& OutAliasedBytes) const;
 	
 	/* ITextureBakerRTPool interface */
 	virtual UTexture2D* GetOrCreateDerivedArt(UTexture2D* Source, const FTextureBakerResourceRequirements& Options) override;
-	virtual UTextureRenderTarget2D* GetOrCreateRT(const FIntPoint& InTargetSize, ETextureRenderTargetFormat Format) override;
+	virtual UTextureRenderTarget2D* GetOrCreateRT(const FIntPoint& InTargetSize, ETextureRenderTargetFormat Format, bool bAutoGenerateMips, const FLinearColor& ClearColor) override;
 	virtual UCanvas* GetOrCreateCanvas() override;
 	virtual bool ReleaseObject(UObject* Object) override;
+	virtual TSharedPtr<FTextureBakerPendingReadback> BeginReadback(UTextureRenderTarget2D* SourceRT, ETextureSourceFormat ImageFormat, ETBImageNormalization Normalization) override;
+	virtual FTextureBakerReadbackArena* GetReadbackArena() override { return &ReadbackArena; }
+	virtual FTextureBakerCompressionQueue* GetTextureBuildQueue() override;
+	virtual void AddTransientLifetimes(const TArray<FTextureBakerTransientLifetime>& Lifetimes) override { FinishedTransientLifetimes.Append(Lifetimes); }
+	virtual UTexture2D* GetDerivedArtOriginal(UTexture2D* Texture) override;
 
 	/* FGCObject interface */
 	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
 	virtual FString GetReferencerName() const { return "TextureBaker render context"; }
 
 private:
+
+	// Renders the output tile by tile into Image, keeping at most GetMaxReadbacksInFlight() tiles on the GPU
+	bool BakeTiledOutput(const FTextureBakerOutputWriteout& OutputInfo, FTextureBakerTiledImage& Image);
 	
 	bool												bIsPreviewContext;
 	UTextureBakerScenario*								OwnedScenario;
@@ -60,7 +130,10 @@ private:
 	TMap<FName, FTextureBakerOutputWriteout>			OutputInfos;
 	TSet<FName>											OutputsToRender;
 
-	TMultiMap<FTextureBakerDerivedArtKey, UTexture2D*>  DerivedArtPool;
-	TArray<UTextureRenderTarget2D*>						RenderTargetPool;
-	TArray<UCanvas*>									CanvasPool;
+	TSharedRef<FTextureBakerResourceCache>				ResourceCache;
+	bool												bUseDerivedArtCache;
+	TSharedRef<FTextureBakerReadbackPool, ESPMode::ThreadSafe> ReadbackPool;
+	FTextureBakerReadbackArena							ReadbackArena;
+	FTextureBakerCompressionQueue						TextureBuildQueue;
+	TArray<FTextureBakerTransientLifetime>				FinishedTransientLifetimes;
 };
\ No newline at end of file
@@ -13,6 +13,8 @@ public:
 	FTextureBakerDrawTarget(UTextureRenderTarget2D* RenderTarget, ERHIFeatureLevel::Type FeatureLevel);
 	void AddReferencedObjects(FReferenceCollector& Collector);
 	void InitializeCanvasObject(UCanvas* Canvas);
+	void SetTileViewport(UCanvas* Canvas, const FIntPoint& OutputSize, const FIntPoint& TileOrigin);
+	bool HasPendingDraws() const;
 	UTexture2D* Resolve(FTextureBakerRenderScope* InRenderScope, TextureMipGenSettings MipGenSettings, ETBImageNormalization Normalization);
 	void Discard(FTextureBakerRenderScope* InRenderScope);
 	void WaitDrawCompletion();
@@ -52,22 +54,37 @@ public:
 	ITextureBakerRTPool* GetRenderTargetPool() const;
 	UTextureRenderTarget2D* CreateTemporaryRT(const FIntPoint& InTargetSize, ETextureRenderTargetFormat Format, FLinearColor ClearColor, bool bAutoGenerateMipMaps);
 	UTexture2D* ConditionallyCreateDerivedArt(UTexture2D* SourceTexture, const FTextureBakerResourceRequirements& Options, ETBDerivedArtMode Mode = ETBDerivedArtMode::None);
+	// Texture derived art was created from, Texture itself otherwise. Size and source of derived art are read from it
+	UTexture2D* GetDerivedArtOriginal(UTexture2D* Texture) const;
 	UTexture2D* CreateTemporaryTexture(UTextureRenderTarget2D* SourceRT, TextureMipGenSettings MipFilter, ETBImageNormalization Normalization);
 	UTexture2D* CreateTemporaryTexture(const FTextureBakerOutputInfo& TextureInfo, ETextureSourceFormat InDataFormat, const void* Data);
 	UCanvas* CreateTemporaryDrawRT(const FIntPoint& InTargetSize, ETextureRenderTargetFormat Format, FLinearColor ClearColor, bool bAutoGenerateMipMaps);
+	UCanvas* CreateTemporaryDrawTile(const FIntPoint& OutputSize, const FIntRect& TileRect, ETextureRenderTargetFormat Format, FLinearColor ClearColor);
+	bool HasPendingDraws(UCanvas* DrawTarget) const;
 	UTexture2D* ResolveTemporaryDrawRT(UCanvas* DrawTarget, TextureMipGenSettings MipGenSettings, ETBImageNormalization Normalization);
 	UTextureRenderTarget2D* ResolveTemporaryDrawRT_AsRenderTarget(UCanvas* DrawTarget);
 	bool ReleaseTemporaryResource(UObject* ResourceObject);
+	// Blocks until the deferred build of a temporary texture is done, so it can be drawn. No-op for textures built synchronously
+	void WaitForTexture(UTexture2D* Texture);
 	bool SetTextureMipsResident(UTexture2D* SourceTexture, bool Value);
 	bool IsTextureSetToBeResident(UTexture2D* Texture);
 
+	// Lifetimes of temporary render targets so far, the ones still in use and the scope itself end now
+	void GetTransientLifetimes(TArray<FTextureBakerTransientLifetime>& OutLifetimes) const;
+
 	virtual void AddReferencedObjects(FReferenceCollector& Collector);
 
 private:
+	// First and last use of temporary render targets, a pooled render target is reused by later requests once its lifetime ends
+	void BeginTransientLifetime(UTextureRenderTarget2D* RenderTarget);
+	void EndTransientLifetime(UTextureRenderTarget2D* RenderTarget);
+
 	TSharedPtr<FTextureBakerRenderScope>			ParentRenderScope;
 	ITextureBakerRTPool*							RenderTargetPool;
 
 	TMap<UCanvas*, FTextureBakerDrawTarget>			ActiveDrawTargets;
 	TMap<UTexture2D*, FSavedTextureStreamingState>	TexturesAreSetToBeResident;
 	TArray<UTexture2D*>								TemporaryTextures;
+	TMap<UTextureRenderTarget2D*, FTextureBakerTransientLifetime>	OpenTransientLifetimes;
+	TArray<FTextureBakerTransientLifetime>			TransientLifetimes;
 };
\ No newline at end of file
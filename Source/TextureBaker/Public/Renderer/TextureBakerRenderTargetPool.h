@@ -0,0 +1,85 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/TextureRenderTarget2D.h"
+
+// Render targets of one format owned by the pool
+struct FTextureBakerRenderTargetOccupancy
+{
+	FTextureBakerRenderTargetOccupancy() : NumInUse(0), NumFree(0), InUseBytes(0), FreeBytes(0) {}
+
+	int32 NumInUse;
+	int32 NumFree;
+	int64 InUseBytes;
+	int64 FreeBytes;
+};
+
+// Free render targets bucketed by everything that defines their RHI resource. A reused render target keeps its resource,
+// so it never goes through UpdateResource again. Once render targets created by the pool exceed TextureBaker.Pool.RenderTargetBudgetMB,
+// least recently released free ones have their resources released. Game thread only
+class TEXTUREBAKER_API FTextureBakerRenderTargetPool
+{
+public:
+	FTextureBakerRenderTargetPool() : UseClock(0), AllocatedBytes(0), PeakBytes(0), NumHits(0), NumMisses(0), NumCreated(0), NumEvicted(0) {}
+
+	// ClearColor is used only for a new render target, it becomes the clear value of its resource
+	UTextureRenderTarget2D* Acquire(const FIntPoint& Size, ETextureRenderTargetFormat Format, bool bAutoGenerateMips, const FLinearColor& ClearColor);
+
+	// Returns false if the render target is in the pool already. A render target the pool didn't hand out is owned from now on
+	bool Release(UTextureRenderTarget2D* RenderTarget);
+
+	// Evicts least recently released free render targets until the allocated ones fit into BudgetBytes, or nothing free is left
+	void Trim(int64 BudgetBytes);
+
+	void AddReferencedObjects(FReferenceCollector& Collector);
+
+	// Counters and the peak start over from the current allocation
+	void ResetStats();
+
+	// Clears the whole surface on the rendering thread. Uses the clear action of the render pass when ClearColor matches the clear value
+	// of the resource, a clear quad otherwise
+	static void Clear(UTextureRenderTarget2D* RenderTarget, const FLinearColor& ClearColor);
+
+	int32 GetNumHits() const { return NumHits; }
+	int32 GetNumMisses() const { return NumMisses; }
+	int32 GetNumCreated() const { return NumCreated; }
+	int32 GetNumEvicted() const { return NumEvicted; }
+	int64 GetAllocatedBytes() const { return AllocatedBytes; }
+	int64 GetPeakBytes() const { return PeakBytes; }
+	const TMap<ETextureRenderTargetFormat, FTextureBakerRenderTargetOccupancy>& GetOccupancy() const { return Occupancy; }
+
+private:
+	struct FBucketKey
+	{
+		FIntPoint Size;
+		ETextureRenderTargetFormat Format;
+		bool bAutoGenerateMips;
+
+		FBucketKey(const FIntPoint& InSize, ETextureRenderTargetFormat InFormat, bool bInAutoGenerateMips) : Size(InSize), Format(InFormat), bAutoGenerateMips(bInAutoGenerateMips) {}
+		explicit FBucketKey(const UTextureRenderTarget2D* RenderTarget) : Size(RenderTarget->SizeX, RenderTarget->SizeY), Format(RenderTarget->RenderTargetFormat), bAutoGenerateMips(RenderTarget->bAutoGenerateMips) {}
+
+		bool operator==(const FBucketKey& Other) const { return Size == Other.Size && Format == Other.Format && bAutoGenerateMips == Other.bAutoGenerateMips; }
+		friend uint32 GetTypeHash(const FBucketKey& Key) { return HashCombine(GetTypeHash(Key.Size), (uint32(Key.Format) << 1) | (Key.bAutoGenerateMips ? 1 : 0)); }
+	};
+
+	struct FFreeRenderTarget
+	{
+		UTextureRenderTarget2D* RenderTarget;
+		uint64 LastUse;
+	};
+
+	static int64 GetResourceBytes(const UTextureRenderTarget2D* RenderTarget);
+
+	// Buckets are in release order, the least recently used entry of a bucket is the first one
+	TMap<FBucketKey, TArray<FFreeRenderTarget>>							FreeRenderTargets;
+	// Handed out by Acquire and not released yet, referenced until they're released
+	TSet<UTextureRenderTarget2D*>										InUseRenderTargets;
+	TMap<ETextureRenderTargetFormat, FTextureBakerRenderTargetOccupancy>	Occupancy;
+	uint64																UseClock;
+	int64																AllocatedBytes;
+	int64																PeakBytes;
+	int32																NumHits;
+	int32																NumMisses;
+	int32																NumCreated;
+	int32																NumEvicted;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+#include "Renderer/TextureBakerRenderTypes.h"
+#include "Renderer/TextureBakerRenderTargetPool.h"
+#include "Renderer/TextureBakerDerivedArtCache.h"
+
+class UCanvas;
+class UTexture2D;
+
+// Render targets, canvases and derived art shared by all render contexts of the editor session, so successive bakes and other open baker tabs
+// start warm. Owned by the module, see FTextureBakerModule::GetResourceCache. Every call takes the cache lock, objects are still created on the
+// game thread only. TextureBaker.FlushResources empties it
+class TEXTUREBAKER_API FTextureBakerResourceCache : public FGCObject
+{
+public:
+	FTextureBakerResourceCache();
+
+	UTextureRenderTarget2D* AcquireRenderTarget(const FIntPoint& Size, ETextureRenderTargetFormat Format, bool bAutoGenerateMips, const FLinearColor& ClearColor);
+	bool ReleaseRenderTarget(UTextureRenderTarget2D* RenderTarget);
+	UCanvas* AcquireCanvas();
+	bool ReleaseCanvas(UCanvas* Canvas);
+
+	// Pooled derived art for the key, nullptr if there's none or it lost its source
+	UTexture2D* FindDerivedArt(const FTextureBakerDerivedArtKey& Key);
+	// Least recently used derived art is dropped from the pool while the pool exceeds TextureBaker.Pool.DerivedArtBudgetMB, Texture is kept.
+	// SourceBytes is the part of Bytes taken by the source copy, OriginalTexture is where the copy came from
+	void AddDerivedArt(const FTextureBakerDerivedArtKey& Key, UTexture2D* Texture, int64 Bytes, int64 SourceBytes, UTexture2D* OriginalTexture);
+	bool RemoveDerivedArt(UTexture2D* Texture);
+
+	// Called once derived art is built, its source copy isn't needed for drawing. See TextureBaker.Pool.ReleaseDerivedArtSource
+	void ReleaseDerivedArtSource(UTexture2D* Texture);
+	// Texture derived art was created from, Texture itself if it isn't derived art or its original is gone. Works after the derived art left the pool
+	UTexture2D* FindDerivedArtOriginal(UTexture2D* Texture) const;
+
+	// Releases every free render target, canvas and derived art. Objects still used by a render context stay with it
+	void Flush();
+	// Counters start over, so they describe a single bake
+	void ResetStats();
+
+	FTextureBakerDerivedArtCache& GetDerivedArtCache() { return DerivedArtCache; }
+	const FTextureBakerDerivedArtCache& GetDerivedArtCache() const { return DerivedArtCache; }
+	const FTextureBakerRenderTargetPool& GetRenderTargetPool() const { return RenderTargetPool; }
+	int64 GetDerivedArtBytes() const { return DerivedArtBytes; }
+	int32 GetNumDerivedArt() const { return DerivedArtUsage.Num(); }
+
+	/* FGCObject interface */
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return "TextureBaker resource cache"; }
+
+private:
+	struct FDerivedArtUsage
+	{
+		uint64 LastUse;
+		int64 Bytes;
+		int64 SourceBytes;
+		bool bSourceReleased;
+	};
+
+	void TrimDerivedArtPool(const UTexture2D* KeepTexture);
+
+	mutable FCriticalSection							Lock;
+	FTextureBakerRenderTargetPool						RenderTargetPool;
+	TArray<UCanvas*>									CanvasPool;
+	TMap<FTextureBakerDerivedArtKey, UTexture2D*>		DerivedArtPool;
+	TMap<UTexture2D*, FDerivedArtUsage>					DerivedArtUsage;
+	TMap<TWeakObjectPtr<UTexture2D>, TWeakObjectPtr<UTexture2D>>	DerivedArtOriginals;
+	uint64												DerivedArtClock;
+	int64												DerivedArtBytes;
+	FTextureBakerDerivedArtCache						DerivedArtCache;
+};
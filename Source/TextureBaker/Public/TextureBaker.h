@@ -9,6 +9,9 @@
 
 class FToolBarBuilder;
 class FMenuBuilder;
+class FTextureBakerCompressionQueue;
+class FTextureBakerSaveQueue;
+class FTextureBakerImageExporter;
 
 class TEXTUREBAKER_API FTextureBakerSurfaceReadback
 {
@@ -22,7 +25,8 @@ public:
 
 	// Perform transcoding. Transcoding can be performd in two ways:
 	// 1. Regular transcoding - ImageDestBuffer is an output buffer with ImageFormat pixels, ReadbackBuffer is non overlapping input buffer with result of calling ReadbackBuffer. Returns ImageDestBuffer
-	// 2. Inline transcoding - ImageDestBuffer is buffer containing ReadbackBuffer output placed without offset. After transcoding result will be placed inside this buffer with some offset. Returns pointer to a transcoded image data.
+	// 2. Inline transcoding - ImageDestBuffer is buffer containing ReadbackBuffer output placed without offset, ReadbackBuffer is nullptr. After transcoding result is placed at the
+	//    beginning of the same buffer. BufferLength must be at least GetRequiredReadbackBufferSize(Size, ImageFormat). Returns pointer to a transcoded image data.
 	//    If buffer is not enough to use inline transcoding or inline transcoding is not supported returns nullptr
 	virtual const void* TranscodeToImageFormat(ETextureSourceFormat ImageFormat, void* ImageDestBuffer, const void* ReadbackBuffer, uint64 PixelNum, uint64 BufferLength) const = 0;
 
@@ -31,6 +35,20 @@ public:
 
 	// Return minimal required buffer size to read surface content and perform inline transcoding to a specified format
 	virtual uint64 GetRequiredReadbackBufferSize(const FIntPoint& TextureSize, ETextureSourceFormat InlineTranscodeTarget) const = 0;
+
+	// Returns true if raw content of a staging copy with given pixel format can be converted to the ReadbackBuffer layout
+	virtual bool SupportsStagingReadback(EPixelFormat SurfaceFormat) const { return false; }
+
+	// Converts mapped staging texture rows to the same layout ReadbackBuffer produces. Called on the rendering thread
+	virtual void ReadbackStagingSurface(const void* SurfaceData, int32 RowPitchInPixels, EPixelFormat SurfaceFormat, const FIntPoint& Size, void* DestBuffer) const {}
+};
+
+enum class ETBSaveResult : uint8
+{
+	Failed,
+	Written,
+	// Image and output attributes match the hash stored with the existing texture, package wasn't touched
+	Unchanged
 };
 
 class TEXTUREBAKER_API FTextureBakerModule : public IModuleInterface
@@ -44,10 +62,30 @@ public:
 	/** This function will be bound to Command (by default it will bring up plugin window) */
 	void PluginButtonClicked();
 	void ExecuteBakerRenderContext(TUniquePtr<FTextureBakerRenderContext> Context);
-	void SaveBakedTextureResult(const FTextureBakerRenderResult& Result, bool bOverrideExistingFiles);
+	/** Writes and saves the output asset. With CompressionQueue the texture build is started asynchronously after saving instead of running inline.
+	 *  With SaveQueue the package is only queued there, the queue saves it and starts the build through its own compression queue.
+	 *  Outputs whose image and attributes hash to the value stored in the package metadata are skipped */
+	ETBSaveResult SaveBakedTextureResult(const FTextureBakerRenderResult& Result, bool bOverrideExistingFiles, FTextureBakerReadbackArena* ReadbackArena = nullptr,
+		FTextureBakerCompressionQueue* CompressionQueue = nullptr, FTextureBakerSaveQueue* SaveQueue = nullptr);
+
+	/** Writes the output to an image file next to its package path, or to the path itself if it isn't a package name. No asset is created.
+	 *  The file is encoded and written by Exporter on a worker thread. Returns false if the image couldn't be read */
+	bool ExportBakedImageResult(const FTextureBakerRenderResult& Result, FTextureBakerImageExporter& Exporter, FTextureBakerReadbackArena* ReadbackArena = nullptr);
+
+	/** Generate texture source data from render target content. If PendingReadback is given, its staging copy is used instead of a blocking surface read when possible.
+	 *  Intermediate readback buffers come from ReadbackArena if given. Source mips below the image are generated according to MipSettings.
+	 *  Without bBuildTexture the texture resource isn't updated, the caller is expected to build it, e.g. through FTextureBakerCompressionQueue */
+	void WriteTexture2DSourceArt(UTexture2D* InTexture2D, ETextureSourceFormat InTextureFormat, UTextureRenderTarget2D* SourceRT, ETBImageNormalization DataRange, FTextureBakerPendingReadback* PendingReadback = nullptr,
+		FTextureBakerReadbackArena* ReadbackArena = nullptr, const FTextureBakerSourceMipSettings& MipSettings = FTextureBakerSourceMipSettings(), bool bBuildTexture = true);
+
+	/** Read render target content as an ImageFormat image of the render target size into ImageBuffer */
+	void ReadRenderTargetImage(ETextureSourceFormat ImageFormat, UTextureRenderTarget2D* SourceRT, ETBImageNormalization DataRange, FTextureBakerPendingReadback* PendingReadback, void* ImageBuffer, FTextureBakerReadbackArena* ReadbackArena = nullptr);
+
+	/** Transcode non-overlapping readback data of a whole image, splitting it into row bands processed in parallel */
+	static void TranscodeImage(const FTextureBakerSurfaceReadback& ReadbackHandler, ETextureSourceFormat ImageFormat, void* ImageDestBuffer, const void* ReadbackBuffer, const FIntPoint& Size);
 
-	/** Generate texture source data from render target content */
-	void WriteTexture2DSourceArt(UTexture2D* InTexture2D, ETextureSourceFormat InTextureFormat, UTextureRenderTarget2D* SourceRT, ETBImageNormalization DataRange);
+	/** Render targets, canvases and derived art shared by all render contexts, created on first use */
+	TSharedRef<FTextureBakerResourceCache> GetResourceCache();
 
 	static FTextureBakerModule* Get() { return static_cast<FTextureBakerModule*>(FModuleManager::Get().GetModule("TextureBaker")); }
 	static FTextureBakerModule& GetChecked() { return FModuleManager::LoadModuleChecked<FTextureBakerModule>("TextureBaker"); }
@@ -55,21 +93,25 @@ public:
 	static ETextureRenderTargetFormat SelectRenderTargetFormatForImageSourceFormat(ETextureSourceFormat OutputImageFormat, bool bUseSRGB);
 	static ETextureSourceFormat SelectImageSourceFormatForRenderTargetFormat(ETextureRenderTargetFormat OutputImageFormat);
 	static TSharedPtr<FTextureBakerSurfaceReadback> GetReadbackHandler(ETextureSourceFormat OutputFormat, bool sRGB, ETBImageNormalization DataRange);
+	/** Handler reading the surface in its native pixel layout where one exists, writing straight into the image when layouts match */
+	static TSharedPtr<FTextureBakerSurfaceReadback> GetReadbackHandler(ETextureSourceFormat OutputFormat, ETextureRenderTargetFormat SurfaceFormat, bool sRGB, ETBImageNormalization DataRange);
 
 private:
 
 	void RegisterMenus();
+	void FinishTexture2DSourceArt(UTexture2D* InTexture2D, bool bSRGB, const FTextureBakerSourceMipSettings& MipSettings, bool bBuildTexture);
 
 	TSharedRef<class SDockTab> OnSpawnPluginTab(const class FSpawnTabArgs& SpawnTabArgs);
 
 private:
 	TSharedPtr<class FUICommandList> PluginCommands;
+	TSharedPtr<FTextureBakerResourceCache> ResourceCache;
 };
 
 namespace FTextureBakerMath
 {
-	void* OffsetPointer(void* BasePointer, int64 Offset) { return reinterpret_cast<uint8*>(BasePointer) + Offset; }
-	const void* OffsetPointer(const void* BasePointer, int64 Offset) { return reinterpret_cast<const uint8*>(BasePointer) + Offset; }
+	inline void* OffsetPointer(void* BasePointer, int64 Offset) { return reinterpret_cast<uint8*>(BasePointer) + Offset; }
+	inline const void* OffsetPointer(const void* BasePointer, int64 Offset) { return reinterpret_cast<const uint8*>(BasePointer) + Offset; }
 	template <typename T> T* OffsetPointer(T* BasePointer, int64 Offset) { return reinterpret_cast<T*>(reinterpret_cast<uint8*>(BasePointer) + Offset); }
 	template <typename T> typename std::make_signed<T>::type Signed(T Value) { return Value; }
 
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/StrongObjectPtr.h"
+#include "Engine/Texture2D.h"
+
+class ITargetPlatform;
+
+// Builds platform data of baked outputs and temporary textures without blocking the game thread. Each texture build runs as an
+// async derived data task, so textures are compressed on worker threads in parallel and the results land in the DDC. Game thread only.
+class TEXTUREBAKER_API FTextureBakerCompressionQueue
+{
+public:
+	FTextureBakerCompressionQueue();
+	~FTextureBakerCompressionQueue();
+
+	// Texture source has to be final. The texture resource isn't updated until the build is finished. Outputs are also
+	// built for target platforms and have their build latency logged. OnBuilt is called once the resource is updated
+	void Add(UTexture2D* Texture, bool bIsOutput = true, TFunction<void(UTexture2D*)> OnBuilt = nullptr);
+
+	// Finishes builds that are already done, without waiting for the others
+	void Tick();
+
+	// Blocks on the build of this texture only, so its resource can be used. Returns false if it had no pending build
+	bool WaitFor(UTexture2D* Texture);
+	bool IsPending(const UTexture2D* Texture) const;
+
+	// Waits for all builds, updates texture resources and logs wall time of the whole batch. Per build time isn't available, builds
+	// overlap and are only polled for completion, so outputs log latency from Add to finish instead
+	void Finish();
+
+	int32 GetNumPending() const { return PendingBuilds.Num(); }
+
+	// False if outputs should be built the regular synchronous way, see TextureBaker.Compression.AtBakeTime
+	static bool IsEnabled();
+
+private:
+	struct FPendingBuild
+	{
+		TStrongObjectPtr<UTexture2D> Texture;
+		double StartTime;
+		bool bIsOutput;
+		TFunction<void(UTexture2D*)> OnBuilt;
+	};
+
+	bool IsBuildComplete(const FPendingBuild& Build) const;
+	void FinishBuild(const FPendingBuild& Build);
+
+	TArray<FPendingBuild>		PendingBuilds;
+	TArray<ITargetPlatform*>	TargetPlatforms;
+	double						BatchStartTime;
+	double						LastFinishTime;
+	double						TotalLatencySeconds;
+	int32						NumBuilt;
+};
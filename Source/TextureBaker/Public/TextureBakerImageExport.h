@@ -0,0 +1,32 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Renderer/TextureBakerRenderTypes.h"
+
+struct FTextureBakerTiledImage;
+
+// Writes baked images straight to image files. Each export is encoded and written on a worker thread, up to
+// TextureBaker.Export.MaxInFlight of them at once. Uncompressed formats are written from the image in row bands without a second copy.
+class TEXTUREBAKER_API FTextureBakerImageExporter
+{
+public:
+	FTextureBakerImageExporter() : NumFailed(0) {}
+	~FTextureBakerImageExporter();
+
+	static bool SupportsFormat(ETBImageFileFormat FileFormat, ETextureSourceFormat ImageFormat);
+	static const TCHAR* GetFileExtension(ETBImageFileFormat FileFormat);
+
+	// Image has to stay unchanged until the export is finished. Blocks while too many exports are in flight
+	void Export(TSharedRef<const FTextureBakerTiledImage> Image, ETBImageFileFormat FileFormat, const FString& FileName);
+
+	// Waits for all exports, returns the number of failed ones
+	int32 Finish();
+
+private:
+	static bool WriteImageFile(const FTextureBakerTiledImage& Image, ETBImageFileFormat FileFormat, const FString& FileName);
+	void WaitForOldest();
+
+	TArray<TFuture<bool>>	PendingExports;
+	int32					NumFailed;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/StrongObjectPtr.h"
+#include "Async/Future.h"
+#include "Engine/Texture2D.h"
+
+class FTextureBakerCompressionQueue;
+
+// Saves packages of baked outputs in batches. Packages are serialized with SAVE_Async, so file writes run in the background while
+// rendering goes on, and the asset registry is notified once for the whole bake. Game thread only.
+class TEXTUREBAKER_API FTextureBakerSaveQueue
+{
+public:
+	FTextureBakerSaveQueue(FTextureBakerCompressionQueue* InCompressionQueue);
+	~FTextureBakerSaveQueue();
+
+	// Texture source has to be written already. PrepareSeconds is time spent on the package before it was queued.
+	// CompressedSource, if valid, replaces the raw source right before the package is serialized
+	void Add(UPackage* Package, UTexture2D* Texture, const FString& PackageFileName, double PrepareSeconds, TFuture<TArray64<uint8>> CompressedSource = TFuture<TArray64<uint8>>());
+
+	// Serializes queued packages and starts their texture builds. Called automatically once TextureBaker.Save.BatchSize packages are queued
+	void Flush();
+
+	// Flushes, waits for file writes, notifies the asset registry and logs timings of each phase
+	void Finish();
+
+	// Textures of queued packages are built by this queue after they're saved, nullptr if they're built inline
+	FTextureBakerCompressionQueue* GetCompressionQueue() const { return CompressionQueue; }
+
+	// False if outputs should be saved one by one, see TextureBaker.Save.Batched
+	static bool IsEnabled();
+
+private:
+	struct FQueuedPackage
+	{
+		TStrongObjectPtr<UPackage> Package;
+		TStrongObjectPtr<UTexture2D> Texture;
+		FString PackageFileName;
+		TFuture<TArray64<uint8>> CompressedSource;
+	};
+
+	FTextureBakerCompressionQueue*	CompressionQueue;
+	TArray<FQueuedPackage>			QueuedPackages;
+	TArray<FString>					SavedFiles;
+	double							PrepareSeconds;
+	double							SerializeSeconds;
+	int32							NumFailed;
+};
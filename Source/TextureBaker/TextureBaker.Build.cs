@@ -47,6 +47,9 @@ public class TextureBaker : ModuleRules
 				"EditorStyle",
 				"ClassViewer",
 				"RHI",
+				"TargetPlatform",
+				"ImageWrapper",
+				"TextureBakerShaders",
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
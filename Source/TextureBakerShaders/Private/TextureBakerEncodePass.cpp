@@ -0,0 +1,203 @@
+#include "TextureBakerEncodePass.h"
+#include "GlobalShader.h"
+#include "ShaderParameterStruct.h"
+#include "RenderGraphUtils.h"
+
+class FTextureBakerEncodeImageCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FTextureBakerEncodeImageCS);
+	SHADER_USE_PARAMETER_STRUCT(FTextureBakerEncodeImageCS, FGlobalShader);
+
+	class FEncodeLayoutDim : SHADER_PERMUTATION_INT("ENCODE_LAYOUT", (int32)ETextureBakerEncodeLayout::Num);
+	using FPermutationDomain = TShaderPermutationDomain<FEncodeLayoutDim>;
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_TEXTURE(Texture2D<float4>, SourceTexture)
+		SHADER_PARAMETER_UAV(RWBuffer<uint>, OutputWords)
+		SHADER_PARAMETER_SRV(Buffer<uint>, ImageRange)
+		SHADER_PARAMETER(uint32, ImageWidth)
+		SHADER_PARAMETER(uint32, ImageHeight)
+		SHADER_PARAMETER(uint32, NumWords)
+		SHADER_PARAMETER(uint32, GroupCountX)
+		SHADER_PARAMETER(uint32, bSingleChannelSource)
+		SHADER_PARAMETER(uint32, bNormalizeRange)
+	END_SHADER_PARAMETER_STRUCT()
+
+	static constexpr int32 ThreadGroupSize = 64;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM5);
+	}
+};
+
+class FTextureBakerImageRangeCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FTextureBakerImageRangeCS);
+	SHADER_USE_PARAMETER_STRUCT(FTextureBakerImageRangeCS, FGlobalShader);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_TEXTURE(Texture2D<float4>, SourceTexture)
+		SHADER_PARAMETER_UAV(RWBuffer<uint>, RangeWords)
+		SHADER_PARAMETER(uint32, ImageWidth)
+		SHADER_PARAMETER(uint32, ImageHeight)
+		SHADER_PARAMETER(uint32, bSingleChannelSource)
+	END_SHADER_PARAMETER_STRUCT()
+
+	static constexpr int32 ThreadGroupSize = 8;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM5);
+	}
+};
+
+IMPLEMENT_GLOBAL_SHADER(FTextureBakerEncodeImageCS, "/Plugin/TextureBaker/Private/ImageUtilities.usf", "EncodeImageCS", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FTextureBakerImageRangeCS, "/Plugin/TextureBaker/Private/ImageUtilities.usf", "ComputeImageRangeCS", SF_Compute);
+
+static ETextureBakerEncodeLayout GetEncodeLayout(ETextureSourceFormat ImageFormat)
+{
+	switch (ImageFormat)
+	{
+	case ETextureSourceFormat::TSF_G8: return ETextureBakerEncodeLayout::G8;
+	case ETextureSourceFormat::TSF_BGRA8: return ETextureBakerEncodeLayout::BGRA8;
+	case ETextureSourceFormat::TSF_RGBA8: return ETextureBakerEncodeLayout::RGBA8;
+	case ETextureSourceFormat::TSF_BGRE8: return ETextureBakerEncodeLayout::BGRE8;
+	case ETextureSourceFormat::TSF_RGBE8: return ETextureBakerEncodeLayout::RGBE8;
+	case ETextureSourceFormat::TSF_G16: return ETextureBakerEncodeLayout::G16;
+	case ETextureSourceFormat::TSF_RGBA16: return ETextureBakerEncodeLayout::RGBA16;
+	case ETextureSourceFormat::TSF_RGBA16F: return ETextureBakerEncodeLayout::RGBA16F;
+	}
+	return ETextureBakerEncodeLayout::Num;
+}
+
+bool FTextureBakerEncodePass::SupportsImageFormat(ETextureSourceFormat ImageFormat)
+{
+	return GetEncodeLayout(ImageFormat) != ETextureBakerEncodeLayout::Num && GMaxRHIFeatureLevel >= ERHIFeatureLevel::SM5;
+}
+
+uint32 FTextureBakerEncodePass::GetEncodedBufferSize(ETextureSourceFormat ImageFormat, const FIntPoint& Size)
+{
+	const uint64 ImageBytes = uint64(FTextureSource::GetBytesPerPixel(ImageFormat)) * Size.X * Size.Y;
+	return Align(ImageBytes, sizeof(uint32));
+}
+
+bool FTextureBakerEncodePass::AddPass(FRHICommandListImmediate& RHICmdList, FRHITexture* SourceTexture, FRWBuffer& OutputBuffer, FRWBuffer& RangeBuffer, const FTextureBakerEncodeSettings& Settings)
+{
+	check(IsInRenderingThread());
+	const ETextureBakerEncodeLayout Layout = GetEncodeLayout(Settings.ImageFormat);
+	if (!SourceTexture || Layout == ETextureBakerEncodeLayout::Num)
+	{
+		return false;
+	}
+
+	const uint32 NumWords = GetEncodedBufferSize(Settings.ImageFormat, Settings.Size) / sizeof(uint32);
+	if (NumWords == 0)
+	{
+		return false;
+	}
+	if (!OutputBuffer.Buffer.IsValid() || OutputBuffer.NumBytes != NumWords * sizeof(uint32))
+	{
+		OutputBuffer.Initialize(sizeof(uint32), NumWords, PF_R32_UINT, BUF_Static | BUF_SourceCopy, TEXT("TextureBakerEncodedImage"));
+	}
+	if (!RangeBuffer.Buffer.IsValid())
+	{
+		RangeBuffer.Initialize(sizeof(uint32), RangeBufferSize / sizeof(uint32), PF_R32_UINT, BUF_Static | BUF_SourceCopy, TEXT("TextureBakerImageRange"));
+	}
+
+	FGlobalShaderMap* GlobalShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+	RHICmdList.Transition({
+		FRHITransitionInfo(SourceTexture, ERHIAccess::Unknown, ERHIAccess::SRVCompute),
+		FRHITransitionInfo(RangeBuffer.UAV, ERHIAccess::Unknown, ERHIAccess::UAVCompute) });
+
+	// Zero is below every encoded value, both for maximums and for inverted minimums
+	RHICmdList.ClearUAVUint(RangeBuffer.UAV, FUintVector4(0, 0, 0, 0));
+	if (Settings.bComputeRange)
+	{
+		TShaderMapRef<FTextureBakerImageRangeCS> RangeShader(GlobalShaderMap);
+		FTextureBakerImageRangeCS::FParameters RangeParameters;
+		RangeParameters.SourceTexture = SourceTexture;
+		RangeParameters.RangeWords = RangeBuffer.UAV;
+		RangeParameters.ImageWidth = Settings.Size.X;
+		RangeParameters.ImageHeight = Settings.Size.Y;
+		RangeParameters.bSingleChannelSource = Settings.bSingleChannelSource ? 1 : 0;
+		FComputeShaderUtils::Dispatch(RHICmdList, RangeShader, RangeParameters, FComputeShaderUtils::GetGroupCount(Settings.Size, FTextureBakerImageRangeCS::ThreadGroupSize));
+	}
+
+	FTextureBakerEncodeImageCS::FPermutationDomain PermutationVector;
+	PermutationVector.Set<FTextureBakerEncodeImageCS::FEncodeLayoutDim>((int32)Layout);
+	TShaderMapRef<FTextureBakerEncodeImageCS> EncodeShader(GlobalShaderMap, PermutationVector);
+
+	const FIntVector GroupCount = FComputeShaderUtils::GetGroupCountWrapped(FMath::DivideAndRoundUp<int32>(NumWords, FTextureBakerEncodeImageCS::ThreadGroupSize));
+
+	FTextureBakerEncodeImageCS::FParameters Parameters;
+	Parameters.SourceTexture = SourceTexture;
+	Parameters.OutputWords = OutputBuffer.UAV;
+	Parameters.ImageRange = RangeBuffer.SRV;
+	Parameters.ImageWidth = Settings.Size.X;
+	Parameters.ImageHeight = Settings.Size.Y;
+	Parameters.NumWords = NumWords;
+	Parameters.GroupCountX = GroupCount.X;
+	Parameters.bSingleChannelSource = Settings.bSingleChannelSource ? 1 : 0;
+	Parameters.bNormalizeRange = (Settings.bComputeRange && Settings.bNormalizeRange) ? 1 : 0;
+
+	RHICmdList.Transition({
+		FRHITransitionInfo(RangeBuffer.UAV, ERHIAccess::UAVCompute, ERHIAccess::SRVCompute),
+		FRHITransitionInfo(OutputBuffer.UAV, ERHIAccess::Unknown, ERHIAccess::UAVCompute) });
+	FComputeShaderUtils::Dispatch(RHICmdList, EncodeShader, Parameters, GroupCount);
+	RHICmdList.Transition({
+		FRHITransitionInfo(SourceTexture, ERHIAccess::SRVCompute, ERHIAccess::SRVMask),
+		FRHITransitionInfo(RangeBuffer.UAV, ERHIAccess::SRVCompute, ERHIAccess::CopySrc),
+		FRHITransitionInfo(OutputBuffer.UAV, ERHIAccess::UAVCompute, ERHIAccess::CopySrc) });
+	return true;
+}
+
+// ToSortable and FromSortable from ImageUtilities.usf: floats as unsigned integers with the same order
+static uint32 ToSortable(float Value)
+{
+	uint32 Bits;
+	FMemory::Memcpy(&Bits, &Value, sizeof(float));
+	return (Bits & 0x80000000u) ? ~Bits : (Bits | 0x80000000u);
+}
+
+static float FromSortable(uint32 Sortable)
+{
+	const uint32 Bits = (Sortable & 0x80000000u) ? (Sortable & 0x7FFFFFFFu) : ~Sortable;
+	float Value;
+	FMemory::Memcpy(&Value, &Bits, sizeof(float));
+	return Value;
+}
+
+void FTextureBakerEncodePass::DecodeRange(const uint32* RangeWords, FLinearColor& OutMin, FLinearColor& OutMax)
+{
+	// Minimums are stored inverted so that both halves are reduced with atomic max
+	for (int32 Channel = 0; Channel < 4; Channel++)
+	{
+		OutMin.Component(Channel) = FromSortable(~RangeWords[Channel]);
+		OutMax.Component(Channel) = FromSortable(RangeWords[Channel + 4]);
+	}
+}
+
+void FTextureBakerEncodePass::AccumulateRange(const FLinearColor& Color, uint32* RangeWords)
+{
+	// NaN takes part as +Infinity for the minimum and -Infinity for the maximum, which never win
+	const uint32 SortableInfinity = 0xFF800000u;
+	for (int32 Channel = 0; Channel < 4; Channel++)
+	{
+		const float Value = Color.Component(Channel);
+		const bool bNaN = FMath::IsNaN(Value);
+		RangeWords[Channel] = FMath::Max(RangeWords[Channel], bNaN ? ~SortableInfinity : ~ToSortable(Value));
+		RangeWords[Channel + 4] = FMath::Max(RangeWords[Channel + 4], bNaN ? ~SortableInfinity : ToSortable(Value));
+	}
+}
+
+void FTextureBakerEncodePass::GetNormalizationRange(const FLinearColor& Min, const FLinearColor& Max, float& OutMin, float& OutMax)
+{
+	OutMin = 0.0f;
+	OutMax = 1.0f;
+	for (int32 Channel = 0; Channel < 4; Channel++)
+	{
+		OutMin = FMath::Min(OutMin, Min.Component(Channel));
+		OutMax = FMath::Max(OutMax, Max.Component(Channel));
+	}
+}
@@ -0,0 +1,15 @@
+#include "TextureBakerShaders.h"
+#include "Interfaces/IPluginManager.h"
+#include "ShaderCore.h"
+
+void FTextureBakerShadersModule::StartupModule()
+{
+	FString PluginShaderDir = FPaths::Combine(IPluginManager::Get().FindPlugin(TEXT("TextureBaker"))->GetBaseDir(), TEXT("Shaders"));
+	AddShaderSourceDirectoryMapping(TEXT("/Plugin/TextureBaker"), PluginShaderDir);
+}
+
+void FTextureBakerShadersModule::ShutdownModule()
+{
+}
+
+IMPLEMENT_MODULE(FTextureBakerShadersModule, TextureBakerShaders)
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI.h"
+#include "RHIUtilities.h"
+#include "Engine/Texture.h"
+
+// Byte layouts produced by the GPU encoding pass. Must match ENCODE_LAYOUT_* in ImageUtilities.usf
+enum class ETextureBakerEncodeLayout : uint8
+{
+	G8,
+	BGRA8,
+	RGBA8,
+	BGRE8,
+	RGBE8,
+	G16,
+	RGBA16,
+	RGBA16F,
+	Num
+};
+
+struct FTextureBakerEncodeSettings
+{
+	FTextureBakerEncodeSettings() : ImageFormat(ETextureSourceFormat::TSF_Invalid), Size(0, 0), bSingleChannelSource(false), bComputeRange(false), bNormalizeRange(false) {}
+
+	ETextureSourceFormat ImageFormat;
+	FIntPoint Size;
+	bool bSingleChannelSource;	// Source is a single channel surface and is widened to gray
+	bool bComputeRange;			// Reduce per channel min/max of the source before encoding
+	bool bNormalizeRange;		// Rescale source by its min/max over all channels, extended to [0, 1]. Requires bComputeRange
+};
+
+/**
+ * Compute pass encoding a float render target into the exact memory layout of an ETextureSourceFormat image,
+ * so that the readback can be copied into the texture source as is. Formulas follow the CPU encoders bit for bit, so images that
+ * need the sRGB curve or the Saturate range mapping aren't encoded here.
+ */
+class TEXTUREBAKERSHADERS_API FTextureBakerEncodePass
+{
+public:
+	static bool SupportsImageFormat(ETextureSourceFormat ImageFormat);
+
+	// Size of the encoded image, rounded up to whole 32 bit words
+	static uint32 GetEncodedBufferSize(ETextureSourceFormat ImageFormat, const FIntPoint& Size);
+
+	// Size of the range record: min RGBA followed by max RGBA, as encoded 32 bit words
+	static constexpr uint32 RangeBufferSize = 8 * sizeof(uint32);
+
+	// Allocates buffers if needed and encodes SourceTexture into OutputBuffer. With bComputeRange the source range is reduced into
+	// RangeBuffer first. Leaves both buffers ready to be copied from. Rendering thread only
+	static bool AddPass(FRHICommandListImmediate& RHICmdList, FRHITexture* SourceTexture, FRWBuffer& OutputBuffer, FRWBuffer& RangeBuffer, const FTextureBakerEncodeSettings& Settings);
+
+	// Decodes a range record read back from RangeBuffer
+	static void DecodeRange(const uint32* RangeWords, FLinearColor& OutMin, FLinearColor& OutMax);
+
+	// Records a pixel into a range record the way the range pass does, NaN channels are left out. Words start zeroed
+	static void AccumulateRange(const FLinearColor& Color, uint32* RangeWords);
+
+	// Range bNormalizeRange rescales by: min/max over all channels, extended to cover [0, 1]
+	static void GetNormalizationRange(const FLinearColor& Min, const FLinearColor& Max, float& OutMin, float& OutMax);
+};
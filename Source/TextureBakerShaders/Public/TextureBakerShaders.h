@@ -0,0 +1,12 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Modules/ModuleManager.h"
+
+// Registers plugin shader directory. Loaded at PostConfigInit, so global shaders are known before shader compilation starts
+class FTextureBakerShadersModule : public IModuleInterface
+{
+public:
+	virtual void StartupModule() override;
+	virtual void ShutdownModule() override;
+};